@@ -1,5 +1,9 @@
 #include "secrets.h"
 #include <WebSocketsClient.h>
+
+// Uncomment this to compress large frames with permessage-deflate
+// #define PROGRAMAKER_DEFLATE
+
 #include "programaker_bridge.hpp"
 
 
@@ -12,8 +16,8 @@
 
 #define DEVICE_ESP8266
 #include "setup_wifi_8266.h"
-#include <NTPClient.h>
-#include <WiFiUdp.h>
+#include "time_sync_8266.h"
+#include <LittleFS.h>
 
 void(* resetFunc) (void) = 0; // declare reset function at address 0
 
@@ -31,55 +35,113 @@ int as_int(JSONVar var) {
     return atoi(str);
 }
 
-WebSocketsClient *webSocket;
+ProgramakerWebSocket *webSocket;
 ProgramakerBridge *bridge = NULL;
 
-void tryConfigure() {
-    // Configure when connected
-    signal_argument single_variable_argument = {
+// Signals sent while disconnected are kept here until the connection is back
+SignalSpool spool(&LittleFS);
+bool spool_ready = false;
+
+// Connection latency measurement
+#define RECONNECT_INTERVAL_MS 5000
+unsigned long connect_started_at = 0;
+
+// Time since the current connection attempt started, 0 while it's waiting to
+// start
+unsigned long connect_elapsed() {
+    long elapsed = (long) (millis() - connect_started_at);
+    return (elapsed > 0) ? elapsed : 0;
+}
+
+// Blocks, kept on flash
+PROGRAMAKER_STRING(sensor_signal_name, "on_sensor_signal");
+PROGRAMAKER_STRING(sensor_signal_message, "On sensor update. Set %1");
+
+const signal_argument sensor_signal_arguments[] PROGMEM = {
+    {
         .arg_type=VARIABLE,
         .type=SINGLE,
-    };
-
-    signal_def sensor_signal = {
-        .id="on_sensor_signal",
-        .fun_name="on_sensor_signal",
-        .key="on_sensor_signal",
-        .message="On sensor update. Set %1",
-        .arguments=std::list<signal_argument>({
-                single_variable_argument,
-            }),
+    },
+};
+
+const signal_def signals[] PROGMEM = {
+    {
+        .id=sensor_signal_name,
+        .fun_name=sensor_signal_name,
+        .key=sensor_signal_name,
+        .message=sensor_signal_message,
+        .arguments=sensor_signal_arguments,
+        .argument_count=PROGRAMAKER_COUNT(sensor_signal_arguments),
         .save_to={
             .index=0
         }
-    };
+    },
+};
+
+const block_registry blocks PROGMEM = {
+    .signals=signals,
+    .signal_count=PROGRAMAKER_COUNT(signals),
+    .getters=NULL,
+    .getter_count=0,
+    .operations=NULL,
+    .operation_count=0,
+};
+
+void tryConfigure() {
+    // Configure when connected
+    if (bridge != NULL) {
+        // Reconnection, keeping the blocks added at runtime
+        bridge->on_connected();
+        return;
+    }
 
     bridge = new ProgramakerBridge(webSocket,
                              BRIDGE_TOKEN,
                              "ESP8266",
-                             std::list<signal_def>({
-                                     sensor_signal,
-                                 }),
-                             std::list<getter_def>({
-                                 }),
-                             std::list<operation_def>({
-                                 }));
+                             &blocks);
+    // Without the flash, signals sent while disconnected are dropped instead
+    if (spool_ready) {
+        bridge->set_spool(&spool);
+    }
+}
+
+#define MAX_FRAGMENTED_MESSAGE 4096
+String fragments;
+bool fragments_overflow = false;
+
+bool append_fragment(uint8_t * payload, size_t length) {
+    if (fragments_overflow || ((fragments.length() + length) > MAX_FRAGMENTED_MESSAGE)) {
+        fragments_overflow = true;
+        fragments = "";
+        return false;
+    }
+
+    fragments.reserve(fragments.length() + length);
+    fragments.concat((const char*) payload, length);
+    return true;
 }
 
 void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
     switch(type) {
     case WStype_DISCONNECTED:
     {
+        // The client will reconnect by itself, signals are spooled meanwhile
         Serial.printf("[WSc] Disconnected\n");
-        fail();
+        // The next attempt starts after the reconnect interval
+        connect_started_at = millis() + RECONNECT_INTERVAL_MS;
+#ifdef PROGRAMAKER_DEFLATE
+        webSocket->print_stats();
+#endif
     }
     break;
 
     case WStype_CONNECTED:
     {
         Serial.printf("[WSc] Connected to url: %s\n",  payload);
+        Serial.printf("[WSc] Handshake took %lu ms\n", connect_elapsed());
 
         tryConfigure();
+        Serial.printf("[WSc] CONFIGURATION sent after %lu ms\n", connect_elapsed());
     }
     break;
 
@@ -100,18 +162,25 @@ void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
         Serial.printf("[WSc] get error length: %u\n", length);
         break;
 
-        // Fragmented transmissions
+        // Fragmented transmissions, reassembled before passing them to the bridge
     case WStype_FRAGMENT_TEXT_START:
-        Serial.printf("[WSc] get fragment text start length: %u\n", length);
-        break;
     case WStype_FRAGMENT_BIN_START:
-        Serial.printf("[WSc] get fragment bin start length: %u\n", length);
+        Serial.printf("[WSc] get fragment start length: %u\n", length);
+        fragments = "";
+        fragments_overflow = false;
+        append_fragment(payload, length);
         break;
     case WStype_FRAGMENT:
         Serial.printf("[WSc] get fragment length: %u\n", length);
+        append_fragment(payload, length);
         break;
     case WStype_FRAGMENT_FIN:
         Serial.printf("[WSc] get fragment fin length: %u\n", length);
+        if (append_fragment(payload, length)) {
+            bridge->on_received_text(fragments.begin(), fragments.length());
+        }
+        fragments = "";
+        fragments_overflow = false;
         break;
 
         // Ping-pong
@@ -134,11 +203,6 @@ int count = 0;
 int to_go = NUM;
 int last_sound = 0; // As is mapped from several readings, it has to be saved
 
-// Define NTP Client to get time
-WiFiUDP ntpUDP;
-const long utcOffsetInSeconds = 0; // We consider timezone=UTC+0
-NTPClient timeClient(ntpUDP, "pool.ntp.org", utcOffsetInSeconds);
-
 void setup() {
     Serial.begin(9600);
     Serial.setDebugOutput(true);
@@ -161,7 +225,12 @@ void setup() {
     delay(5000);
 #endif
 
-    timeClient.begin();
+    setup_time();
+
+    spool_ready = LittleFS.begin() && spool.begin();
+    if (!spool_ready) {
+        Serial.println("Signal spool not available");
+    }
 
     connect();
 }
@@ -173,26 +242,19 @@ void connect() {
         delete webSocket;
     }
 
-    timeClient.update();
+    connect_started_at = millis();
 
-    struct timeval realtime;
-    realtime.tv_sec = timeClient.getEpochTime();
-    realtime.tv_usec = 0;
-    settimeofday(&realtime, NULL);
-
-    time_t t = time(NULL);
-    struct tm tm = *localtime(&t);
-    Serial.printf("=> Current time: %i/%i/%i %i:%i:%i\n", tm.tm_year + 1900,
-                  tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
-
-    webSocket = new WebSocketsClient();
+    webSocket = new ProgramakerWebSocket();
 #ifdef USE_SSL
     webSocket->beginSslWithCA(ENDPOINT_HOST, ENDPOINT_PORT, ENDPOINT_PATH, ENDPOINT_CA_CERT);
 #else
     webSocket->begin(ENDPOINT_HOST, ENDPOINT_PORT, ENDPOINT_PATH);
+#endif
+#ifdef PROGRAMAKER_DEFLATE
+    webSocket->offer_deflate();
 #endif
     webSocket->onEvent(webSocketEvent);
-    webSocket->setReconnectInterval(5000);
+    webSocket->setReconnectInterval(RECONNECT_INTERVAL_MS);
     webSocket->enableHeartbeat(15000, 15000, 2);
 }
 
@@ -216,12 +278,17 @@ void update_sensor_signal() {
 
 // the loop function runs over and over again forever
 void loop() {
+    time_sync_loop();
+    spool.loop();
+
     if (bridge != NULL) {
+      // Kept across reconnections, it runs the websocket loop from now on
       bridge->loop();
       update_sensor_signal();
       delay(10);
     }
     else {
+      // The bridge is created on the first connection
       webSocket->loop();
     }
 }
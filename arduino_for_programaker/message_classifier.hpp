@@ -0,0 +1,115 @@
+// Classification of the received frames before they are decoded.
+//
+// The raw frame is scanned once: the structure is validated and the message
+// type is found without building any document. This way malformed messages
+// and types not handled by the bridge are rejected before spending time and
+// heap on a full decode.
+//
+// Uses the JSON scanner from programaker_codec.hpp.
+
+#define CLASSIFIER_MAX_DEPTH 16
+
+enum MESSAGE_CLASS {
+    MESSAGE_FUNCTION_CALL,
+    MESSAGE_REGISTRATION,
+    MESSAGE_GET_HOW_TO_SERVICE_REGISTRATION,
+    MESSAGE_UNKNOWN,   // Valid message of a type not handled by the bridge
+    MESSAGE_MALFORMED,
+};
+
+typedef struct {
+    enum MESSAGE_CLASS message_class;
+
+    // Raw "message_id" string, with its quotes. Can be copied as is to a
+    // response. NULL if not present.
+    const char* message_id;
+    size_t message_id_length;
+} message_classification;
+
+void classify_message(const char* text, size_t length, message_classification* result) {
+    const char* end = text + length;
+    const char* type = NULL;
+    const char* type_end = NULL;
+    bool value_is_object = false;
+
+    result->message_class = MESSAGE_MALFORMED;
+    result->message_id = NULL;
+    result->message_id_length = 0;
+
+    const char* p = json_skip_whitespace(text, end);
+    if ((p >= end) || (*p != '{')) {
+        return;
+    }
+    p = json_skip_whitespace(p + 1, end);
+
+    bool first = true;
+    while ((p < end) && (*p != '}')) {
+        if (!first) {
+            if (*p != ',') {
+                return;
+            }
+            p = json_skip_whitespace(p + 1, end);
+        }
+        first = false;
+
+        const char* key = p;
+        p = json_skip_string(p, end);
+        if (p == NULL) {
+            return;
+        }
+        const char* key_end = p;
+
+        p = json_skip_whitespace(p, end);
+        if ((p >= end) || (*p != ':')) {
+            return;
+        }
+        p = json_skip_whitespace(p + 1, end);
+
+        const char* value = p;
+        p = json_skip_value(p, end, CLASSIFIER_MAX_DEPTH);
+        if (p == NULL) {
+            return;
+        }
+
+        if (*value == '"') {
+            if (json_key_is(key, key_end, "type")) {
+                type = value;
+                type_end = p;
+            }
+            else if (json_key_is(key, key_end, "message_id")) {
+                result->message_id = value;
+                result->message_id_length = p - value;
+            }
+        }
+        else if ((*value == '{') && json_key_is(key, key_end, "value")) {
+            value_is_object = true;
+        }
+
+        p = json_skip_whitespace(p, end);
+    }
+
+    if ((p >= end) || (json_skip_whitespace(p + 1, end) != end)) {
+        // Not closed, or trailing data
+        return;
+    }
+
+    if (type == NULL) {
+        return;
+    }
+
+    if (json_key_is(type, type_end, "FUNCTION_CALL")) {
+        // Calls need an ID to be answered and a value with the function
+        if ((result->message_id != NULL) && value_is_object) {
+            result->message_class = MESSAGE_FUNCTION_CALL;
+        }
+    }
+    else if (json_key_is(type, type_end, "REGISTRATION")) {
+        result->message_class = MESSAGE_REGISTRATION;
+    }
+    else if (json_key_is(type, type_end, "GET_HOW_TO_SERVICE_REGISTRATION")) {
+        result->message_class = MESSAGE_GET_HOW_TO_SERVICE_REGISTRATION;
+    }
+    else {
+        result->message_class = MESSAGE_UNKNOWN;
+    }
+}
@@ -0,0 +1,725 @@
+#include <WebSocketsClient.h>
+
+// permessage-deflate (RFC 7692) for the frames sent by the bridge.
+//
+// The compressor is a small LZ77 with fixed Huffman codes, using a window of
+// 2^DEFLATE_WINDOW_BITS bytes, so it fits in a couple of KB of RAM. The window
+// is kept across messages (context takeover) unless the server disables it.
+// Frames under DEFLATE_MIN_SIZE bytes are sent uncompressed.
+//
+// Frames received compressed are inflated by DeflateDecoder. To bound the RAM
+// needed the offer asks the server for a window of 2^DEFLATE_WINDOW_BITS bytes
+// and no context takeover, so each message is inflated on its own, up to
+// DEFLATE_MAX_INFLATED_SIZE bytes.
+//
+// The extension is opt-in, see PROGRAMAKER_DEFLATE on the bridge.
+
+#ifndef DEFLATE_WINDOW_BITS
+#define DEFLATE_WINDOW_BITS 10
+#endif
+
+#ifndef DEFLATE_MIN_SIZE
+#define DEFLATE_MIN_SIZE 128
+#endif
+
+#ifndef DEFLATE_MAX_INFLATED_SIZE
+#define DEFLATE_MAX_INFLATED_SIZE 4096
+#endif
+
+#define DEFLATE_STRING(value) #value
+#define DEFLATE_EXPAND_STRING(value) DEFLATE_STRING(value)
+
+#define DEFLATE_HASH_BITS 8
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+
+const uint16_t DEFLATE_LENGTH_BASE[] PROGMEM = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+const uint8_t DEFLATE_LENGTH_EXTRA[] PROGMEM = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+const uint16_t DEFLATE_DISTANCE_BASE[] PROGMEM = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+const uint8_t DEFLATE_DISTANCE_EXTRA[] PROGMEM = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+class DeflateEncoder {
+    uint8_t window[1 << DEFLATE_WINDOW_BITS]; // Last bytes compressed
+    uint32_t head[1 << DEFLATE_HASH_BITS];    // Last position of each hash
+    uint32_t position = 0;      // Bytes compressed since the start
+    uint32_t history_start = 0; // First position that can be referenced
+    uint32_t max_distance = (1 << DEFLATE_WINDOW_BITS) - 1;
+
+    // Output
+    uint8_t* out;
+    size_t out_length;
+    uint32_t bit_buffer;
+    uint8_t bit_count;
+
+public:
+    bool context_takeover = true;
+
+    DeflateEncoder() {
+        memset(this->head, 0, sizeof(this->head));
+    }
+
+    // Start from an empty history, for a new connection
+    void reset() {
+        this->history_start = this->position;
+    }
+
+    // Limit the window to 2^bits bytes, as agreed with the server
+    void set_window_bits(uint8_t bits) {
+        if (bits < DEFLATE_WINDOW_BITS) {
+            this->max_distance = (1 << bits) - 1;
+        }
+    }
+
+    // Upper bound of the compressed size of `length` bytes
+    static size_t max_compressed_size(size_t length) {
+        return length + (length / 8) + 8;
+    }
+
+    // Compress `data` as a single message, without the trailing
+    // 0x00 0x00 0xff 0xff. `out` must have max_compressed_size(length) bytes.
+    size_t compress(const uint8_t* data, size_t length, uint8_t* out) {
+        this->out = out;
+        this->out_length = 0;
+        this->bit_buffer = 0;
+        this->bit_count = 0;
+
+        if (!this->context_takeover) {
+            this->history_start = this->position;
+        }
+
+        // Non final block, fixed Huffman codes
+        this->write_bits(0, 1);
+        this->write_bits(1, 2);
+
+        const uint32_t base = this->position;
+        size_t i = 0;
+        while (i < length) {
+            size_t match_length = 0;
+            uint32_t match_distance = 0;
+
+            if ((length - i) >= DEFLATE_MIN_MATCH) {
+                uint32_t hash = this->hash(data + i);
+                uint32_t candidate = this->head[hash];
+                uint32_t current = base + i;
+                this->head[hash] = current;
+
+                uint32_t distance = current - candidate;
+                if ((candidate >= this->history_start) && (distance > 0)
+                    && (distance <= this->max_distance)) {
+                    size_t max_length = ((length - i) < DEFLATE_MAX_MATCH) ? (length - i) : DEFLATE_MAX_MATCH;
+                    while ((match_length < max_length)
+                           && (this->byte_at(candidate + match_length, data, base)
+                               == data[i + match_length])) {
+                        match_length++;
+                    }
+                    match_distance = distance;
+                }
+            }
+
+            if (match_length >= DEFLATE_MIN_MATCH) {
+                this->write_match(match_length, match_distance);
+
+                // Index the positions inside the match too
+                for (size_t j = 1; (j < match_length) && ((i + j + DEFLATE_MIN_MATCH) <= length); j++) {
+                    this->head[this->hash(data + i + j)] = base + i + j;
+                }
+                i += match_length;
+            }
+            else {
+                this->write_literal(data[i]);
+                i++;
+            }
+        }
+
+        // End of block, and empty stored block to align to a byte (sync flush)
+        this->write_literal(256);
+        this->write_bits(0, 3);
+        if (this->bit_count > 0) {
+            this->write_bits(0, 8 - this->bit_count);
+        }
+
+        // Keep the tail of the message as history for the next ones
+        for (size_t j = (length > sizeof(this->window)) ? (length - sizeof(this->window)) : 0;
+             j < length; j++) {
+            this->window[(base + j) & (sizeof(this->window) - 1)] = data[j];
+        }
+        this->position += length;
+
+        return this->out_length;
+    }
+
+private:
+    static uint32_t hash(const uint8_t* data) {
+        uint32_t value = (data[0] << 16) | (data[1] << 8) | data[2];
+        return (value * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+    }
+
+    uint8_t byte_at(uint32_t position, const uint8_t* data, uint32_t base) {
+        if (position >= base) {
+            return data[position - base];
+        }
+        return this->window[position & (sizeof(this->window) - 1)];
+    }
+
+    void write_bits(uint32_t value, uint8_t count) {
+        this->bit_buffer |= value << this->bit_count;
+        this->bit_count += count;
+        while (this->bit_count >= 8) {
+            this->out[this->out_length++] = this->bit_buffer & 0xFF;
+            this->bit_buffer >>= 8;
+            this->bit_count -= 8;
+        }
+    }
+
+    // Huffman codes are written starting from the most significant bit
+    void write_code(uint32_t code, uint8_t count) {
+        uint32_t reversed = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            reversed = (reversed << 1) | ((code >> i) & 1);
+        }
+        this->write_bits(reversed, count);
+    }
+
+    void write_literal(uint16_t symbol) {
+        if (symbol < 144) {
+            this->write_code(0x30 + symbol, 8);
+        }
+        else if (symbol < 256) {
+            this->write_code(0x190 + (symbol - 144), 9);
+        }
+        else if (symbol < 280) {
+            this->write_code(symbol - 256, 7);
+        }
+        else {
+            this->write_code(0xC0 + (symbol - 280), 8);
+        }
+    }
+
+    void write_match(size_t length, uint32_t distance) {
+        uint8_t code = 0;
+        while ((code < 28) && (pgm_read_word(&DEFLATE_LENGTH_BASE[code + 1]) <= length)) {
+            code++;
+        }
+        this->write_literal(257 + code);
+        this->write_bits(length - pgm_read_word(&DEFLATE_LENGTH_BASE[code]),
+                         pgm_read_byte(&DEFLATE_LENGTH_EXTRA[code]));
+
+        code = 0;
+        while ((code < 29) && (pgm_read_word(&DEFLATE_DISTANCE_BASE[code + 1]) <= distance)) {
+            code++;
+        }
+        this->write_code(code, 5);
+        this->write_bits(distance - pgm_read_word(&DEFLATE_DISTANCE_BASE[code]),
+                         pgm_read_byte(&DEFLATE_DISTANCE_EXTRA[code]));
+    }
+};
+
+
+// Inflater for the messages received, each one with its own history
+class DeflateDecoder {
+    typedef struct {
+        uint16_t counts[16];   // Number of codes of each length
+        uint16_t symbols[288]; // Symbols ordered by code
+    } huffman_table;
+
+    huffman_table literals;
+    huffman_table distances;
+
+    // Input, followed by the 0x00 0x00 0xff 0xff removed by the sender
+    const uint8_t* in;
+    size_t in_length;
+    size_t in_position;
+    uint32_t bit_buffer;
+    uint8_t bit_count;
+    bool error;
+
+    uint8_t* out;
+    size_t out_length;
+    size_t out_capacity;
+
+public:
+    // Inflate a message. Returns a null-terminated buffer to be free()'d, or
+    // NULL if the data is not valid or inflates to more than
+    // DEFLATE_MAX_INFLATED_SIZE bytes.
+    uint8_t* inflate(const uint8_t* data, size_t length, size_t* inflated_length) {
+        this->in = data;
+        this->in_length = length + 4;
+        this->in_position = 0;
+        this->bit_buffer = 0;
+        this->bit_count = 0;
+        this->error = false;
+
+        this->out_capacity = (length * 3) + 16;
+        if (this->out_capacity > DEFLATE_MAX_INFLATED_SIZE) {
+            this->out_capacity = DEFLATE_MAX_INFLATED_SIZE;
+        }
+        this->out_length = 0;
+        this->out = (uint8_t*) malloc(this->out_capacity + 1);
+        if (this->out == NULL) {
+            return NULL;
+        }
+
+        bool final_block = false;
+        while ((!final_block) && (!this->error)) {
+            if ((this->in_position >= this->in_length) && (this->bit_count == 0)) {
+                // End of the sync flush
+                break;
+            }
+
+            final_block = this->read_bits(1);
+            switch (this->read_bits(2)) {
+            case 0:
+                this->stored_block();
+                break;
+            case 1:
+                this->fixed_tables();
+                this->compressed_block();
+                break;
+            case 2:
+                this->dynamic_tables();
+                this->compressed_block();
+                break;
+            default:
+                this->error = true;
+            }
+        }
+
+        if (this->error) {
+            free(this->out);
+            return NULL;
+        }
+
+        this->out[this->out_length] = '\0';
+        *inflated_length = this->out_length;
+        return this->out;
+    }
+
+private:
+    uint8_t input_byte() {
+        if (this->in_position >= this->in_length) {
+            this->error = true;
+            return 0;
+        }
+        size_t position = this->in_position++;
+        if (position < (this->in_length - 4)) {
+            return this->in[position];
+        }
+        // Trailing 0x00 0x00 0xff 0xff
+        return (position < (this->in_length - 2)) ? 0x00 : 0xff;
+    }
+
+    uint32_t read_bits(uint8_t count) {
+        while (this->bit_count < count) {
+            this->bit_buffer |= ((uint32_t) this->input_byte()) << this->bit_count;
+            this->bit_count += 8;
+        }
+        uint32_t value = this->bit_buffer & ((1u << count) - 1);
+        this->bit_buffer >>= count;
+        this->bit_count -= count;
+        return value;
+    }
+
+    bool emit(uint8_t byte) {
+        if (this->out_length >= this->out_capacity) {
+            if (this->out_capacity >= DEFLATE_MAX_INFLATED_SIZE) {
+                Serial.println("[Deflate] Inflated message too big");
+                this->error = true;
+                return false;
+            }
+            size_t capacity = this->out_capacity * 2;
+            if (capacity > DEFLATE_MAX_INFLATED_SIZE) {
+                capacity = DEFLATE_MAX_INFLATED_SIZE;
+            }
+            uint8_t* grown = (uint8_t*) realloc(this->out, capacity + 1);
+            if (grown == NULL) {
+                this->error = true;
+                return false;
+            }
+            this->out = grown;
+            this->out_capacity = capacity;
+        }
+        this->out[this->out_length++] = byte;
+        return true;
+    }
+
+    void stored_block() {
+        // Skip to the byte boundary
+        this->bit_buffer = 0;
+        this->bit_count = 0;
+
+        uint16_t length = this->input_byte();
+        length |= this->input_byte() << 8;
+        uint16_t length_complement = this->input_byte();
+        length_complement |= this->input_byte() << 8;
+        if ((length ^ 0xFFFF) != length_complement) {
+            this->error = true;
+            return;
+        }
+
+        while ((length-- > 0) && (!this->error)) {
+            this->emit(this->input_byte());
+        }
+    }
+
+    static void build_table(huffman_table* table, const uint8_t* lengths, size_t count) {
+        uint16_t offsets[16];
+
+        memset(table->counts, 0, sizeof(table->counts));
+        for (size_t i = 0; i < count; i++) {
+            table->counts[lengths[i]]++;
+        }
+        table->counts[0] = 0;
+
+        offsets[1] = 0;
+        for (int i = 1; i < 15; i++) {
+            offsets[i + 1] = offsets[i] + table->counts[i];
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (lengths[i] != 0) {
+                table->symbols[offsets[lengths[i]]++] = i;
+            }
+        }
+    }
+
+    int decode_symbol(const huffman_table* table) {
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (int length = 1; length < 16; length++) {
+            code |= this->read_bits(1);
+            int count = table->counts[length];
+            if ((code - first) < count) {
+                return table->symbols[index + (code - first)];
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        this->error = true;
+        return -1;
+    }
+
+    void fixed_tables() {
+        uint8_t lengths[288];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        build_table(&this->literals, lengths, 288);
+
+        memset(lengths, 5, 30);
+        build_table(&this->distances, lengths, 30);
+    }
+
+    void dynamic_tables() {
+        static const uint8_t order[19] = {
+            16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+        };
+        uint8_t lengths[288 + 32];
+
+        size_t literal_count = this->read_bits(5) + 257;
+        size_t distance_count = this->read_bits(5) + 1;
+        size_t length_code_count = this->read_bits(4) + 4;
+        if ((literal_count > 286) || (distance_count > 30)) {
+            this->error = true;
+            return;
+        }
+
+        // Code lengths of the code length alphabet, on `literals`
+        memset(lengths, 0, 19);
+        for (size_t i = 0; i < length_code_count; i++) {
+            lengths[order[i]] = this->read_bits(3);
+        }
+        build_table(&this->literals, lengths, 19);
+
+        size_t total = literal_count + distance_count;
+        size_t i = 0;
+        while ((i < total) && (!this->error)) {
+            int symbol = this->decode_symbol(&this->literals);
+            if (symbol < 0) {
+                return;
+            }
+            if (symbol < 16) {
+                lengths[i++] = symbol;
+                continue;
+            }
+
+            uint8_t value = 0;
+            size_t repeat;
+            if (symbol == 16) {
+                if (i == 0) {
+                    this->error = true;
+                    return;
+                }
+                value = lengths[i - 1];
+                repeat = 3 + this->read_bits(2);
+            }
+            else if (symbol == 17) {
+                repeat = 3 + this->read_bits(3);
+            }
+            else {
+                repeat = 11 + this->read_bits(7);
+            }
+
+            if ((i + repeat) > total) {
+                this->error = true;
+                return;
+            }
+            while (repeat-- > 0) {
+                lengths[i++] = value;
+            }
+        }
+        if (this->error) {
+            return;
+        }
+
+        build_table(&this->literals, lengths, literal_count);
+        build_table(&this->distances, lengths + literal_count, distance_count);
+    }
+
+    void compressed_block() {
+        while (!this->error) {
+            int symbol = this->decode_symbol(&this->literals);
+            if (symbol < 0) {
+                return;
+            }
+            if (symbol < 256) {
+                if (!this->emit(symbol)) {
+                    return;
+                }
+                continue;
+            }
+            if (symbol == 256) {
+                return;
+            }
+
+            symbol -= 257;
+            if (symbol >= 29) {
+                this->error = true;
+                return;
+            }
+            size_t length = pgm_read_word(&DEFLATE_LENGTH_BASE[symbol])
+                + this->read_bits(pgm_read_byte(&DEFLATE_LENGTH_EXTRA[symbol]));
+
+            int distance_symbol = this->decode_symbol(&this->distances);
+            if ((distance_symbol < 0) || (distance_symbol >= 30)) {
+                this->error = true;
+                return;
+            }
+            size_t distance = pgm_read_word(&DEFLATE_DISTANCE_BASE[distance_symbol])
+                + this->read_bits(pgm_read_byte(&DEFLATE_DISTANCE_EXTRA[distance_symbol]));
+
+            if (distance > this->out_length) {
+                // Referencing a previous message, without context takeover
+                // this can't happen
+                this->error = true;
+                return;
+            }
+            while ((length-- > 0) && (!this->error)) {
+                this->emit(this->out[this->out_length - distance]);
+            }
+        }
+    }
+};
+
+
+// WebSocketsClient compressing the text frames once the server has accepted
+// permessage-deflate, and inflating the ones received compressed. Call
+// offer_deflate() after begin().
+class PermessageDeflateClient : public WebSocketsClient {
+    DeflateEncoder encoder;
+    DeflateDecoder decoder;
+    bool negotiated = false;
+
+    // Compressed message being received, fragments are joined before
+    // inflating it
+    bool receiving_compressed = false;
+    WSopcode_t compressed_opcode;
+    uint8_t* compressed = NULL;
+    size_t compressed_length = 0;
+    bool compressed_overflow = false;
+
+public:
+    // Statistics, to measure the compression ratio and cost
+    unsigned long bytes_in = 0;
+    unsigned long bytes_out = 0;
+    unsigned long compress_micros = 0;
+    unsigned long received_compressed = 0;
+    unsigned long received_inflated = 0;
+
+    ~PermessageDeflateClient() {
+        free(this->compressed);
+    }
+
+    using WebSocketsClient::sendTXT;
+
+    void offer_deflate() {
+        this->setExtraHeaders("Origin: file://\r\n"
+                              "Sec-WebSocket-Extensions: permessage-deflate; "
+                              "client_max_window_bits=" DEFLATE_EXPAND_STRING(DEFLATE_WINDOW_BITS) "; "
+                              "server_max_window_bits=" DEFLATE_EXPAND_STRING(DEFLATE_WINDOW_BITS) "; "
+                              "server_no_context_takeover");
+    }
+
+    bool sendTXT(String& payload) {
+        if ((!this->negotiated) || (payload.length() < DEFLATE_MIN_SIZE)) {
+            return WebSocketsClient::sendTXT(payload);
+        }
+
+        unsigned long start = micros();
+        uint8_t* compressed = (uint8_t*) malloc(DeflateEncoder::max_compressed_size(payload.length()));
+        if (compressed == NULL) {
+            return WebSocketsClient::sendTXT(payload);
+        }
+
+        // Once the encoder has seen the data it must be sent compressed, the
+        // server window has to follow ours.
+        size_t length = this->encoder.compress((const uint8_t*) payload.c_str(),
+                                               payload.length(), compressed);
+        this->compress_micros += micros() - start;
+        this->bytes_in += payload.length();
+        this->bytes_out += length;
+
+        // RSV1 marks the frame as compressed
+        bool result = this->sendFrame(&this->_client, (WSopcode_t) (WSop_text | 0x40),
+                                      compressed, length, true, false);
+        free(compressed);
+        return result;
+    }
+
+    void print_stats() {
+        if (this->bytes_in > 0) {
+            Serial.printf("[Deflate] %lu -> %lu bytes (%lu%%), %lu us compressing\n",
+                          this->bytes_in, this->bytes_out,
+                          (this->bytes_out * 100) / this->bytes_in, this->compress_micros);
+        }
+        if (this->received_compressed > 0) {
+            Serial.printf("[Deflate] Received %lu bytes, %lu inflated\n",
+                          this->received_compressed, this->received_inflated);
+        }
+    }
+
+protected:
+    void runCbEvent(WStype_t type, uint8_t * payload, size_t length) {
+        if (type == WStype_CONNECTED) {
+            this->check_negotiation();
+        }
+        else if (type == WStype_DISCONNECTED) {
+            this->negotiated = false;
+            this->discard_compressed();
+        }
+
+        WebSocketsClient::runCbEvent(type, payload, length);
+    }
+
+    void messageReceived(WSclient_t * client, WSopcode_t opcode, uint8_t * payload,
+                         size_t length, bool fin) {
+        bool first_frame = (opcode == WSop_text) || (opcode == WSop_binary);
+        if (first_frame) {
+            // RSV1 is only set on the first frame of a compressed message
+            this->receiving_compressed = this->negotiated && client->cWsHeaderDecode.rsv1;
+            this->discard_compressed();
+            this->compressed_opcode = opcode;
+        }
+
+        if ((!this->receiving_compressed)
+            || ((!first_frame) && (opcode != WSop_continuation))) {
+            // Not compressed, or control frames
+            WebSocketsClient::messageReceived(client, opcode, payload, length, fin);
+            return;
+        }
+
+        this->append_compressed(payload, length);
+        if (!fin) {
+            return;
+        }
+        this->receiving_compressed = false;
+
+        if (this->compressed_overflow) {
+            Serial.println("[Deflate] Compressed message too big, dropped");
+            this->discard_compressed();
+            return;
+        }
+
+        size_t inflated_length = 0;
+        uint8_t* inflated = this->decoder.inflate(this->compressed, this->compressed_length,
+                                                  &inflated_length);
+        this->received_compressed += this->compressed_length;
+        this->discard_compressed();
+        if (inflated == NULL) {
+            Serial.println("[Deflate] Cannot inflate message, dropped");
+            return;
+        }
+        this->received_inflated += inflated_length;
+
+        // Passed on as a single frame message
+        WebSocketsClient::messageReceived(client, this->compressed_opcode,
+                                          inflated, inflated_length, true);
+        free(inflated);
+    }
+
+private:
+    void append_compressed(const uint8_t* payload, size_t length) {
+        if (this->compressed_overflow) {
+            return;
+        }
+        size_t total = this->compressed_length + length;
+        uint8_t* grown = (total <= DEFLATE_MAX_INFLATED_SIZE)
+            ? (uint8_t*) realloc(this->compressed, total > 0 ? total : 1)
+            : NULL;
+        if (grown == NULL) {
+            this->compressed_overflow = true;
+            return;
+        }
+        this->compressed = grown;
+        memcpy(this->compressed + this->compressed_length, payload, length);
+        this->compressed_length = total;
+    }
+
+    void discard_compressed() {
+        free(this->compressed);
+        this->compressed = NULL;
+        this->compressed_length = 0;
+        this->compressed_overflow = false;
+    }
+
+    // Called on each connection, after the server headers have been read
+    void check_negotiation() {
+        this->negotiated = false;
+        this->encoder.reset();
+
+        String extensions = this->_client.cExtensions;
+        if (extensions.indexOf("permessage-deflate") < 0) {
+            Serial.println("[Deflate] Not accepted by the server");
+            return;
+        }
+        this->negotiated = true;
+
+        this->encoder.context_takeover = (extensions.indexOf("client_no_context_takeover") < 0);
+
+        int bits_index = extensions.indexOf("client_max_window_bits=");
+        if (bits_index >= 0) {
+            int bits = extensions.substring(bits_index + strlen("client_max_window_bits=")).toInt();
+            if (bits > 0) {
+                this->encoder.set_window_bits(bits);
+            }
+        }
+        if (extensions.indexOf("server_no_context_takeover") < 0) {
+            Serial.println("[Deflate] The server keeps its context, messages"
+                           " referencing previous ones won't be inflated");
+        }
+        Serial.printf("[Deflate] Negotiated: %s\n", extensions.c_str());
+    }
+};
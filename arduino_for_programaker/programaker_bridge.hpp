@@ -1,5 +1,39 @@
 #include <Arduino_JSON.h>
-#include <list>
+#include "signal_spool.hpp"
+#include "programaker_codec.hpp"
+#include "message_classifier.hpp"
+
+// Define PROGRAMAKER_SIGNAL_DELTA before including this file to enable
+// send_signal_delta(). Needs a receiver that understands the deltas, which
+// PrograMaker doesn't, see signal_delta.hpp
+#ifdef PROGRAMAKER_SIGNAL_DELTA
+#include "signal_delta.hpp"
+#endif
+
+// Define PROGRAMAKER_CONFIGURATION_UPDATE before including this file to send
+// only the changed blocks when they are modified at runtime. Needs a receiver
+// that understands CONFIGURATION_UPDATE, which PrograMaker doesn't, so by
+// default the whole CONFIGURATION is sent again.
+
+// Define PROGRAMAKER_DEFLATE before including this file to use
+// permessage-deflate on the connection, see permessage_deflate.hpp
+#ifdef PROGRAMAKER_DEFLATE
+#include "permessage_deflate.hpp"
+typedef PermessageDeflateClient ProgramakerWebSocket;
+#else
+typedef WebSocketsClient ProgramakerWebSocket;
+#endif
+
+// Spooled signals are sent on batches of SPOOL_DRAIN_BATCH, one batch each
+// SPOOL_DRAIN_INTERVAL_MS, to avoid flooding the connection after a reconnect.
+#define SPOOL_DRAIN_BATCH 8
+#define SPOOL_DRAIN_INTERVAL_MS 100
+
+// Blocks that can be added, updated or removed after the bridge is created,
+// see ProgramakerBridge::add_signal()
+#ifndef PROGRAMAKER_MAX_RUNTIME_BLOCKS
+#define PROGRAMAKER_MAX_RUNTIME_BLOCKS 8
+#endif
 
 enum ARGUMENT_TYPE {
     VARIABLE,
@@ -17,6 +51,12 @@ enum VARIABLE_TYPE {
     LIST,
 };
 
+// Block definitions are meant to be kept on flash: declare them as PROGMEM
+// arrays, with all their strings declared with PROGRAMAKER_STRING. The bridge
+// reads them from there when needed, without copying them to RAM.
+#define PROGRAMAKER_STRING(name, value) static const char name[] PROGMEM = value
+#define PROGRAMAKER_COUNT(array) (sizeof(array) / sizeof((array)[0]))
+
 typedef struct {
     enum ARGUMENT_TYPE arg_type;
     enum VARIABLE_TYPE type;
@@ -24,12 +64,12 @@ typedef struct {
 
 typedef struct {
     enum VALUE_ARGUMENT_TYPE type;
-    char* default_value;
+    const char* default_value;
 } getter_argument;
 
 typedef struct {
     enum VALUE_ARGUMENT_TYPE type;
-    char* default_value;
+    const char* default_value;
 } operation_argument;
 
 typedef struct {
@@ -38,53 +78,179 @@ typedef struct {
 } argument_reference;
 
 typedef struct {
-    char* id;
-    char* fun_name;
-    char* key;
-    String message;
-    std::list<signal_argument> arguments;
+    const char* id;
+    const char* fun_name;
+    const char* key;
+    const char* message;
+    const signal_argument* arguments;
+    size_t argument_count;
     argument_reference save_to;
 } signal_def;
 
 typedef struct {
-    char* id;
-    char* fun_name;
-    String message;
-    std::list<getter_argument> arguments;
+    const char* id;
+    const char* fun_name;
+    const char* message;
+    const getter_argument* arguments;
+    size_t argument_count;
 
     // enum BLOCK_RESULT_TYPE result_type;
     JSONVar (*callback) (JSONVar); // Pointer to the callback function
 } getter_def;
 
 typedef struct {
-    char* id;
-    char* fun_name;
-    String message;
-    std::list<operation_argument> arguments;
+    const char* id;
+    const char* fun_name;
+    const char* message;
+    const operation_argument* arguments;
+    size_t argument_count;
 
     // enum BLOCK_RESULT_TYPE result_type;
     JSONVar (*callback) (JSONVar); // Pointer to the callback function
 } operation_def;
 
+// All the blocks of a bridge
+typedef struct {
+    const signal_def* signals;
+    size_t signal_count;
+    const getter_def* getters;
+    size_t getter_count;
+    const operation_def* operations;
+    size_t operation_count;
+} block_registry;
+
+typedef JSONVar (*block_callback) (JSONVar);
+
+enum BLOCK_KIND {
+    SIGNAL_BLOCK,
+    GETTER_BLOCK,
+    OPERATION_BLOCK,
+};
+
+// Block changed at runtime. `def` points to a signal_def, getter_def or
+// operation_def, depending on `kind`.
 typedef struct {
-    char* function_name;
-    JSONVar (*callback) (JSONVar);
-} callback_register;
+    enum BLOCK_KIND kind;
+    const void* def;
+    bool removed; // Hides the block with the same ID on the registry
+} runtime_block;
+
+// Copy a PROGMEM structure to RAM
+template <typename T>
+T read_flash(const T* flash) {
+    T value;
+    memcpy_P(&value, flash, sizeof(T));
+    return value;
+}
 
 class ProgramakerBridge {
-    WebSocketsClient *ws;
-    std::list<callback_register> callbacks;
+    ProgramakerWebSocket *ws;
+    block_registry registry;
+    SignalSpool *spool = NULL;
+    ProgramakerCodec *codec;
+    JSONVarCodec default_codec;
+    String auth_token;
+    String name;
+
+    // Changes over the registry, looked up before it
+    runtime_block runtime_blocks[PROGRAMAKER_MAX_RUNTIME_BLOCKS];
+    size_t runtime_block_count = 0;
+
+#ifdef PROGRAMAKER_SIGNAL_DELTA
+    SignalDelta deltas;
+#endif
 
 public:
-    ProgramakerBridge(WebSocketsClient *ws,
+    ProgramakerBridge(ProgramakerWebSocket *ws,
                       String auth_token,
                       String name,
-                      std::list<signal_def> signals,
-                      std::list<getter_def> getters,
-                      std::list<operation_def> operations) {
+                      const block_registry *registry, // On PROGMEM
+                      ProgramakerCodec *codec = NULL) {
         this->ws = ws;
-        this->auth(auth_token);
-        this->configure(name, signals, getters, operations);
+        this->registry = read_flash(registry);
+        this->codec = (codec != NULL) ? codec : &this->default_codec;
+        this->auth_token = auth_token;
+        this->name = name;
+        this->on_connected();
+    }
+
+    // Authenticate and configure again, after a reconnection. The blocks
+    // changed at runtime are kept.
+    void on_connected() {
+#ifdef PROGRAMAKER_SIGNAL_DELTA
+        this->deltas.reset();
+#endif
+        this->auth(this->auth_token);
+        this->configure(this->name);
+    }
+
+    // Add a block after the bridge has been created (for example, for a
+    // peripheral that has just been plugged), or update the one with the same
+    // ID. The definition is not copied, it has to outlive the bridge: keep it
+    // on PROGMEM like the registry.
+    //
+    // The whole CONFIGURATION is sent again, or only the changed block with
+    // PROGRAMAKER_CONFIGURATION_UPDATE. When disconnected it's included on the
+    // next CONFIGURATION.
+    //
+    // Returns false if there's no space left (see PROGRAMAKER_MAX_RUNTIME_BLOCKS).
+    bool add_signal(const signal_def* signal) {
+        return this->set_runtime_block(SIGNAL_BLOCK, signal);
+    }
+
+    bool add_getter(const getter_def* getter) {
+        return this->set_runtime_block(GETTER_BLOCK, getter);
+    }
+
+    bool add_operation(const operation_def* operation) {
+        return this->set_runtime_block(OPERATION_BLOCK, operation);
+    }
+
+    // Remove a block, either from the registry or added at runtime. Its
+    // function can't be called after this.
+    //
+    // Returns false if the block is not found or there's no space left.
+    bool remove_block(const char* id) {
+        int index = this->find_runtime_block(id);
+        if ((index >= 0) && this->runtime_blocks[index].removed) {
+            return false;
+        }
+
+        runtime_block on_registry;
+        if (this->find_registry_block(id, &on_registry)) {
+            // Keep it hidden
+            on_registry.removed = true;
+            if (index >= 0) {
+                this->runtime_blocks[index] = on_registry;
+            }
+            else if (!this->append_runtime_block(on_registry)) {
+                return false;
+            }
+        }
+        else if (index >= 0) {
+            this->runtime_block_count--;
+            for (size_t i = index; i < this->runtime_block_count; i++) {
+                this->runtime_blocks[i] = this->runtime_blocks[i + 1];
+            }
+        }
+        else {
+            return false;
+        }
+
+#ifdef PROGRAMAKER_CONFIGURATION_UPDATE
+        JSONVar removed = JSON.parse("[]");
+        removed[0] = id;
+        this->send_configuration_update(JSON.parse("[]"), removed);
+#else
+        this->reconfigure();
+#endif
+        return true;
+    }
+
+    // Keep the signals sent while disconnected on `spool`, to be sent when
+    // the connection is available again.
+    void set_spool(SignalSpool *spool) {
+        this->spool = spool;
     }
 
     void loop() {
@@ -92,95 +258,480 @@ public:
             this->responses_in_loop = false;
             this->ws->loop();
         } while (this->responses_in_loop);
+
+        this->drain_spool();
     }
 
-    void send_signal(String key, JSONVar value){
-        JSONVar doc;
-        JSONVar to_user; // Null
-        doc["type"] = "NOTIFICATION";
-        doc["key"] = key;
-        doc["to_user"] = to_user;
+    void send_signal(const String& key, const JSONVar& value){
+        if ((this->spool != NULL)
+            && ((!this->ws->isConnected()) || this->spool->has_pending())) {
+            // Keep the order with the signals already on the spool
+            this->spool->append(key, JSON.stringify(value));
+            return;
+        }
 
-        // @TODO Separate content and value
-        doc["content"] = value;
-        doc["value"] = value;
+        this->send_notification(key, value);
+    }
 
-        Serial.println(doc);
+#ifdef PROGRAMAKER_SIGNAL_DELTA
+    // Like send_signal(), but for object values only the fields changed
+    // since the last update are sent, see signal_delta.hpp. The receiver has
+    // to merge them into the last whole value.
+    void send_signal_delta(const String& key, JSONVar& value){
+        if ((!this->ws->isConnected())
+            || ((this->spool != NULL) && this->spool->has_pending())) {
+            // Sent whole, the spool doesn't keep deltas
+            this->deltas.reset();
+            this->send_signal(key, value);
+            return;
+        }
 
-        String jsonString = JSON.stringify(doc);
+        JSONVar delta;
+        if (this->deltas.update(key, value, &delta)) {
+            this->send_notification(key, value);
+            return;
+        }
+
+        String jsonString = this->codec->encode_delta_notification(key, delta);
+        Serial.println(jsonString);
         this->ws->sendTXT(jsonString);
     }
+#endif
 
     void on_received_text(char* text, size_t length) {
         this->responses_in_loop = false;
 
-        text[length] = '\0';
-        Serial.printf("Received: %s\n", text);
-        JSONVar var = JSON.parse((char*)text);
-        const char* type = (const char*) var["type"];
-        const char* message_id = (const char*) var["message_id"];
-        if (strcmp(type, "FUNCTION_CALL") == 0){
-            JSONVar value = var["value"];
-            const char* function_name = (const char*) value["function_name"];
-            for(const auto& callback : callbacks) {
-                if (strcmp(function_name, callback.function_name) == 0) {
-                    JSONVar result = callback.callback(value["arguments"]);
-
-                    JSONVar response;
-                    response["message_id"] = message_id;
-                    response["success"] = true;
-                    response["result"] = result;
-
-                    String jsonString = JSON.stringify(response);
-                    this->ws->sendTXT(jsonString);
-
-                    break;
-                }
-            }
-        }
-        else if (strcmp(type, "GET_HOW_TO_SERVICE_REGISTRATION") == 0){
-            JSONVar response;
-            response["message_id"] = message_id;
-            response["success"] = true;
-            response["result"] = nullptr;
+        Serial.printf("Received: %.*s\n", (int) length, text);
 
-            String jsonString = JSON.stringify(response);
-            this->ws->sendTXT(jsonString);
-        }
-        else if (strcmp(type, "REGISTRATION") == 0){
-            JSONVar response;
-            response["message_id"] = message_id;
-            response["success"] = true;
-            response["result"] = nullptr;
+        message_classification classification;
+        classify_message(text, length, &classification);
+
+        switch (classification.message_class) {
+        case MESSAGE_FUNCTION_CALL:
+            this->on_function_call(text, length);
+            break;
 
-            String jsonString = JSON.stringify(response);
-            this->ws->sendTXT(jsonString);
+        case MESSAGE_REGISTRATION:
+        case MESSAGE_GET_HOW_TO_SERVICE_REGISTRATION:
+            // Nothing to do, no need to decode them
+            this->send_raw_response(classification, "\"success\":true,\"result\":null");
+            break;
+
+        case MESSAGE_UNKNOWN:
+            Serial.println("Unknown message type");
+            this->send_raw_response(classification, "\"success\":false,\"error\":\"Unknown message type\"");
+            break;
+
+        case MESSAGE_MALFORMED:
+            Serial.println("Malformed message");
+            this->send_raw_response(classification, "\"success\":false,\"error\":\"Malformed message\"");
+            break;
         }
     }
 
 private:
     bool responses_in_loop = false;
+    unsigned long last_drain = 0;
+    unsigned long drain_started = 0;
+    unsigned long drained = 0;
+
+    void on_function_call(char* text, size_t length) {
+        // Already validated by the classifier, but the codec might have
+        // tighter limits. There's no reliable message ID to answer to then.
+        programaker_message message;
+        if (!this->codec->decode(text, length, &message)) {
+            Serial.println("Cannot decode message");
+            return;
+        }
 
-    void auth(String auth_token) {
-        // Build auth message
-        JSONVar doc;
-        doc["type"] = "AUTHENTICATION";
+        block_callback callback = this->find_callback(message.function_name);
+        if (callback == NULL) {
+            Serial.println("Unknown function");
+            this->send_error(message.message_id, "Unknown function");
+            return;
+        }
 
-        JSONVar value;
-        value["token"] = auth_token;
+        JSONVar result = callback(this->codec->arguments());
 
-        doc["value"] = value;
+        String jsonString = this->codec->encode_response(message.message_id, result);
+        this->ws->sendTXT(jsonString);
+    }
 
-        // Send message
-        String jsonString = JSON.stringify(doc);
+    void send_error(const char* message_id, const char* error) {
+        if (message_id == NULL) {
+            return;
+        }
+
+        String response = "{\"message_id\":";
+        json_append_string(response, message_id);
+        response += ",\"success\":false,\"error\":";
+        json_append_string(response, error);
+        response += '}';
+
+        this->ws->sendTXT(response);
+    }
+
+    // Answer with the message ID as found by the classifier, without decoding
+    // the message. `fields` are added after it.
+    void send_raw_response(const message_classification& classification,
+                           const char* fields) {
+        if (classification.message_id == NULL) {
+            // Nobody to answer to
+            return;
+        }
+
+        String response;
+        response.reserve(classification.message_id_length + strlen(fields) + 20);
+        response += "{\"message_id\":";
+        for (size_t i = 0; i < classification.message_id_length; i++) {
+            response += classification.message_id[i];
+        }
+        response += ',';
+        response += fields;
+        response += '}';
+
+        this->ws->sendTXT(response);
+    }
+
+    bool send_notification(const String& key, const JSONVar& value) {
+        String jsonString = this->codec->encode_notification(key, value);
+        Serial.println(jsonString);
+
+        return this->ws->sendTXT(jsonString);
+    }
+
+    void drain_spool() {
+        if ((this->spool == NULL) || (!this->ws->isConnected())
+            || (!this->spool->has_pending())
+            || ((millis() - this->last_drain) < SPOOL_DRAIN_INTERVAL_MS)) {
+            return;
+        }
+        this->last_drain = millis();
+
+        if (this->drained == 0) {
+            this->drain_started = this->last_drain;
+        }
+
+        this->drained += this->spool->drain(SPOOL_DRAIN_BATCH,
+                                            [this](const String& key, const String& value) {
+                                                return this->send_notification(key, JSON.parse(value));
+                                            });
+
+        if (!this->spool->has_pending()) {
+            unsigned long elapsed = millis() - this->drain_started;
+            Serial.printf("[Spool] Drained %lu signals in %lu ms (%lu signals/s)\n",
+                          this->drained, elapsed,
+                          (this->drained * 1000) / (elapsed > 0 ? elapsed : 1));
+            this->drained = 0;
+        }
+    }
+
+    void auth(String auth_token) {
+        String jsonString = this->codec->encode_authentication(auth_token);
         this->ws->sendTXT(jsonString);
         Serial.println("SENT AUTHENTICATION");
     }
 
-    void configure(String name,
-                   std::list<signal_def> signals,
-                   std::list<getter_def> getters,
-                   std::list<operation_def> operations){
+    block_callback find_callback(const char* function_name) {
+        if (function_name == NULL) {
+            return NULL;
+        }
+
+        // Runtime changes first, they hide the registry blocks with the same ID
+        for (size_t i = 0; i < this->runtime_block_count; i++) {
+            const runtime_block& block = this->runtime_blocks[i];
+            if (strcmp_P(function_name, block_fun_name(block)) == 0) {
+                return block.removed ? NULL : block_callback_of(block);
+            }
+        }
+
+        for (size_t i = 0; i < this->registry.getter_count; i++) {
+            getter_def getter = read_flash(&this->registry.getters[i]);
+            if ((strcmp_P(function_name, getter.fun_name) == 0)
+                && (!this->has_runtime_block(getter.id))) {
+                return getter.callback;
+            }
+        }
+
+        for (size_t i = 0; i < this->registry.operation_count; i++) {
+            operation_def operation = read_flash(&this->registry.operations[i]);
+            if ((strcmp_P(function_name, operation.fun_name) == 0)
+                && (!this->has_runtime_block(operation.id))) {
+                return operation.callback;
+            }
+        }
+
+        return NULL;
+    }
+
+    bool set_runtime_block(enum BLOCK_KIND kind, const void* def) {
+        runtime_block block = { .kind=kind, .def=def, .removed=false };
+
+        int index = this->find_runtime_block_P(block_id(block));
+        if (index >= 0) {
+            this->runtime_blocks[index] = block;
+        }
+        else if (!this->append_runtime_block(block)) {
+            return false;
+        }
+
+#ifdef PROGRAMAKER_CONFIGURATION_UPDATE
+        JSONVar blocks = JSON.parse("[]");
+        blocks[0] = block_json(block);
+        this->send_configuration_update(blocks, JSON.parse("[]"));
+#else
+        this->reconfigure();
+#endif
+        return true;
+    }
+
+    bool append_runtime_block(const runtime_block& block) {
+        if (this->runtime_block_count >= PROGRAMAKER_MAX_RUNTIME_BLOCKS) {
+            Serial.println("No space for runtime blocks");
+            return false;
+        }
+        this->runtime_blocks[this->runtime_block_count++] = block;
+        return true;
+    }
+
+    // `id` on RAM
+    int find_runtime_block(const char* id) {
+        for (size_t i = 0; i < this->runtime_block_count; i++) {
+            if (strcmp_P(id, block_id(this->runtime_blocks[i])) == 0) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // `id` on PROGMEM. Called for every block on dispatch and configuration,
+    // so it doesn't allocate.
+    int find_runtime_block_P(const char* id) {
+        if (this->runtime_block_count == 0) {
+            return -1;
+        }
+
+        for (size_t i = 0; i < this->runtime_block_count; i++) {
+            if (flash_strings_equal(id, block_id(this->runtime_blocks[i]))) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Both strings on PROGMEM
+    static bool flash_strings_equal(const char* a, const char* b) {
+        if (a == b) {
+            return true;
+        }
+
+        uint8_t c;
+        do {
+            c = pgm_read_byte(a++);
+            if (c != pgm_read_byte(b++)) {
+                return false;
+            }
+        } while (c != '\0');
+        return true;
+    }
+
+    bool has_runtime_block(const char* id) {
+        return this->find_runtime_block_P(id) >= 0;
+    }
+
+    // `id` on RAM
+    bool find_registry_block(const char* id, runtime_block* found) {
+        for (size_t i = 0; i < this->registry.signal_count; i++) {
+            if (strcmp_P(id, read_flash(&this->registry.signals[i]).id) == 0) {
+                *found = { .kind=SIGNAL_BLOCK, .def=&this->registry.signals[i], .removed=false };
+                return true;
+            }
+        }
+
+        for (size_t i = 0; i < this->registry.getter_count; i++) {
+            if (strcmp_P(id, read_flash(&this->registry.getters[i]).id) == 0) {
+                *found = { .kind=GETTER_BLOCK, .def=&this->registry.getters[i], .removed=false };
+                return true;
+            }
+        }
+
+        for (size_t i = 0; i < this->registry.operation_count; i++) {
+            if (strcmp_P(id, read_flash(&this->registry.operations[i]).id) == 0) {
+                *found = { .kind=OPERATION_BLOCK, .def=&this->registry.operations[i], .removed=false };
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    static const char* block_id(const runtime_block& block) {
+        switch (block.kind) {
+        case SIGNAL_BLOCK:
+            return read_flash((const signal_def*) block.def).id;
+        case GETTER_BLOCK:
+            return read_flash((const getter_def*) block.def).id;
+        case OPERATION_BLOCK:
+            return read_flash((const operation_def*) block.def).id;
+        }
+        return NULL;
+    }
+
+    static const char* block_fun_name(const runtime_block& block) {
+        switch (block.kind) {
+        case SIGNAL_BLOCK:
+            return read_flash((const signal_def*) block.def).fun_name;
+        case GETTER_BLOCK:
+            return read_flash((const getter_def*) block.def).fun_name;
+        case OPERATION_BLOCK:
+            return read_flash((const operation_def*) block.def).fun_name;
+        }
+        return NULL;
+    }
+
+    static block_callback block_callback_of(const runtime_block& block) {
+        switch (block.kind) {
+        case SIGNAL_BLOCK:
+            // Signals are not called
+            return NULL;
+        case GETTER_BLOCK:
+            return read_flash((const getter_def*) block.def).callback;
+        case OPERATION_BLOCK:
+            return read_flash((const operation_def*) block.def).callback;
+        }
+        return NULL;
+    }
+
+    static JSONVar block_json(const runtime_block& block) {
+        switch (block.kind) {
+        case SIGNAL_BLOCK:
+            return signal_block(read_flash((const signal_def*) block.def));
+        case GETTER_BLOCK:
+            return getter_block(read_flash((const getter_def*) block.def));
+        case OPERATION_BLOCK:
+            return operation_block(read_flash((const operation_def*) block.def));
+        }
+        return JSONVar();
+    }
+
+    static const char* value_argument_type_name(enum VALUE_ARGUMENT_TYPE type) {
+        switch(type) {
+        case STRING:
+            return "string";
+        case INTEGER:
+            return "integer";
+        case FLOAT:
+            return "float";
+        case BOOLEAN:
+            return "boolean";
+        }
+        return NULL;
+    }
+
+    static JSONVar signal_block(const signal_def& signal) {
+        JSONVar block;
+        block["id"] = String(FPSTR(signal.id));
+        block["function_name"] = String(FPSTR(signal.fun_name));
+        block["key"] = String(FPSTR(signal.key));
+        block["block_type"] = "trigger";
+        block["message"] = String(FPSTR(signal.message));
+        block["expected_value"] = nullptr;
+
+        JSONVar arguments = JSON.parse("[]");
+
+        int arg_count = 0;
+        for (size_t i = 0; i < signal.argument_count; i++) {
+            signal_argument arg = read_flash(&signal.arguments[i]);
+            JSONVar argument;
+
+            switch(arg.arg_type) {
+            case VARIABLE:
+                argument["type"] = "variable";
+                break;
+            }
+
+            switch (arg.type) {
+            case SINGLE:
+                argument["class"] = "single";
+                break;
+            case LIST:
+                argument["class"] = "list";
+                break;
+            }
+
+            arguments[arg_count] = argument;
+            arg_count++;
+        }
+
+        int save_to_index = signal.save_to.index;
+        if ((save_to_index < 0) ||
+            (save_to_index > arg_count)) {
+            block["save_to"] = nullptr;
+        }
+        else {
+            JSONVar save_to;
+            save_to["type"] = "argument";
+            save_to["index"] = save_to_index;
+            block["save_to"] = save_to;
+        }
+
+        block["arguments"] = arguments;
+        return block;
+    }
+
+    static JSONVar getter_block(const getter_def& getter) {
+        JSONVar block;
+
+        block["id"] = String(FPSTR(getter.id));
+        block["function_name"] = String(FPSTR(getter.fun_name));
+        block["block_type"] = "getter";
+        block["block_result_type"] = nullptr;
+        block["message"] = String(FPSTR(getter.message));
+
+        JSONVar arguments = JSON.parse("[]");
+        for (size_t i = 0; i < getter.argument_count; i++) {
+            getter_argument arg = read_flash(&getter.arguments[i]);
+            JSONVar argument;
+
+            argument["type"] = value_argument_type_name(arg.type);
+            if (arg.default_value != NULL) {
+                argument["default"] = String(FPSTR(arg.default_value));
+            }
+
+            arguments[(int) i] = argument;
+        }
+
+        block["arguments"] = arguments;
+        return block;
+    }
+
+    static JSONVar operation_block(const operation_def& operation) {
+        JSONVar block;
+
+        block["id"] = String(FPSTR(operation.id));
+        block["function_name"] = String(FPSTR(operation.fun_name));
+        block["block_type"] = "operation";
+        block["block_result_type"] = nullptr;
+        block["message"] = String(FPSTR(operation.message));
+
+        JSONVar arguments = JSON.parse("[]");
+        for (size_t i = 0; i < operation.argument_count; i++) {
+            operation_argument arg = read_flash(&operation.arguments[i]);
+            JSONVar argument;
+
+            argument["type"] = value_argument_type_name(arg.type);
+            if (arg.default_value != NULL) {
+                argument["default"] = String(FPSTR(arg.default_value));
+            }
+
+            arguments[(int) i] = argument;
+        }
+
+        block["arguments"] = arguments;
+        return block;
+    }
+
+    void configure(String name){
         JSONVar doc;
         doc["type"] = "CONFIGURATION";
 
@@ -194,154 +745,75 @@ private:
         value["icon"] = icon;
         JSONVar blocks = JSON.parse("[]");
         int block_count = 0;
-        for (const auto& signal : signals) {
-            JSONVar block;
-            block["id"] = signal.id;
-            block["function_name"] = signal.fun_name;
-            block["key"] = signal.key;
-            block["block_type"] = "trigger";
-            block["message"] = signal.message;
-            block["expected_value"] = nullptr;
-
-            JSONVar arguments = JSON.parse("[]");
-
-            int arg_count = 0;
-            for(const auto& arg : signal.arguments) {
-                JSONVar argument;
-
-                switch(arg.arg_type) {
-                case VARIABLE:
-                    argument["type"] = "variable";
-                    break;
-                }
-
-                switch (arg.type) {
-                case SINGLE:
-                    argument["class"] = "single";
-                    break;
-                case LIST:
-                    argument["class"] = "list";
-                    break;
-                }
-
-                arguments[arg_count] = argument;
-                arg_count++;
+        for (size_t i = 0; i < this->registry.signal_count; i++) {
+            signal_def signal = read_flash(&this->registry.signals[i]);
+            if (!this->has_runtime_block(signal.id)) {
+                blocks[block_count] = signal_block(signal);
+                block_count++;
             }
+        }
 
-            int save_to_index = signal.save_to.index;
-            if ((save_to_index < 0) ||
-                (save_to_index > arg_count)) {
-                block["save_to"] = nullptr;
-            }
-            else {
-                JSONVar save_to;
-                save_to["type"] = "argument";
-                save_to["index"] = save_to_index;
-                block["save_to"] = save_to;
+        for (size_t i = 0; i < this->registry.getter_count; i++) {
+            getter_def getter = read_flash(&this->registry.getters[i]);
+            if (!this->has_runtime_block(getter.id)) {
+                blocks[block_count] = getter_block(getter);
+                block_count++;
             }
+        }
 
-            block["arguments"] = arguments;
-            blocks[block_count] = block;
-            block_count++;
-        }
-
-        for (const auto& getter : getters) {
-            JSONVar block;
-
-            block["id"] = getter.id;
-            block["function_name"] = getter.fun_name;
-            block["block_type"] = "getter";
-            block["block_result_type"] = nullptr;
-            block["message"] = getter.message;
-
-            JSONVar arguments = JSON.parse("[]");
-            int arg_count = 0;
-            for(const auto& arg : getter.arguments) {
-                JSONVar argument;
-
-                switch(arg.type) {
-                case STRING:
-                    argument["type"] = "string";
-                    break;
-                case INTEGER:
-                    argument["type"] = "integer";
-                    break;
-                case FLOAT:
-                    argument["type"] = "float";
-                    break;
-                case BOOLEAN:
-                    argument["type"] = "boolean";
-                    break;
-                }
-                argument["default"] = arg.default_value;
-
-                arguments[arg_count] = argument;
-                arg_count++;
+        for (size_t i = 0; i < this->registry.operation_count; i++) {
+            operation_def operation = read_flash(&this->registry.operations[i]);
+            if (!this->has_runtime_block(operation.id)) {
+                blocks[block_count] = operation_block(operation);
+                block_count++;
             }
+        }
 
-            block["arguments"] = arguments;
-            blocks[block_count] = block;
-            block_count++;
-
-            callbacks.push_back({
-                    .function_name=getter.fun_name,
-                    .callback=getter.callback,
-                });
-        }
-
-        for (const auto& operation : operations) {
-            JSONVar block;
-
-            block["id"] = operation.id;
-            block["function_name"] = operation.fun_name;
-            block["block_type"] = "operation";
-            block["block_result_type"] = nullptr;
-            block["message"] = operation.message;
-
-            JSONVar arguments = JSON.parse("[]");
-
-            int arg_count = 0;
-            for(const auto& arg : operation.arguments) {
-                JSONVar argument;
-
-                switch(arg.type) {
-                case STRING:
-                    argument["type"] = "string";
-                    break;
-                case INTEGER:
-                    argument["type"] = "integer";
-                    break;
-                case FLOAT:
-                    argument["type"] = "float";
-                    break;
-                case BOOLEAN:
-                    argument["type"] = "boolean";
-                    break;
-                }
-                argument["default"] = arg.default_value;
-
-                arguments[arg_count] = argument;
-                arg_count++;
+        // Added or updated at runtime
+        for (size_t i = 0; i < this->runtime_block_count; i++) {
+            if (!this->runtime_blocks[i].removed) {
+                blocks[block_count] = block_json(this->runtime_blocks[i]);
+                block_count++;
             }
+        }
 
-            block["arguments"] = arguments;
-            blocks[block_count] = block;
-            block_count++;
+        value["blocks"] = blocks;
+        doc["value"] = value;
 
-            callbacks.push_back({
-                    .function_name=operation.fun_name,
-                    .callback=operation.callback,
-                });
+        String jsonString = JSON.stringify(doc);
+        Serial.println(jsonString);
+        this->ws->sendTXT(jsonString);
+        Serial.println("OK");
+    }
+
+    // Send the whole CONFIGURATION with the runtime changes applied
+    void reconfigure() {
+        if (!this->ws->isConnected()) {
+            // Will be on the next CONFIGURATION
+            return;
+        }
+        this->configure(this->name);
+    }
+
+#ifdef PROGRAMAKER_CONFIGURATION_UPDATE
+    // Send only the blocks added or updated, and the IDs of the removed ones
+    void send_configuration_update(JSONVar blocks, JSONVar removed) {
+        if (!this->ws->isConnected()) {
+            // Will be on the next CONFIGURATION
+            return;
         }
 
+        JSONVar doc;
+        doc["type"] = "CONFIGURATION_UPDATE";
+
+        JSONVar value;
         value["blocks"] = blocks;
+        value["removed"] = removed;
         doc["value"] = value;
 
-        Serial.println(doc);
-
         String jsonString = JSON.stringify(doc);
         Serial.println(jsonString);
         this->ws->sendTXT(jsonString);
-        Serial.println("OK");
     }
+#endif
 };
@@ -0,0 +1,655 @@
+#include <Arduino_JSON.h>
+
+// Codecs translate between the PrograMaker protocol messages and the bridge.
+//
+// Block callbacks and signal values are still handled as JSONVar, the codec
+// only takes care of the message envelopes, which are built and parsed once
+// per frame.
+//
+// Available codecs:
+//  - JSONVarCodec: uses Arduino_JSON for everything.
+//  - MinimalCodec: hand-rolled scanner and encoder, decodes in place.
+//  - ArduinoJsonCodec: ArduinoJson with static documents. Requires the
+//    ArduinoJson library and PROGRAMAKER_CODEC_ARDUINOJSON to be defined.
+
+// Fields of an incoming message, NULL when not present.
+// Valid until the next call to decode().
+typedef struct {
+    const char* type;
+    const char* message_id;
+    const char* function_name;
+} programaker_message;
+
+class ProgramakerCodec {
+public:
+    virtual ~ProgramakerCodec() {}
+
+    virtual const char* name() = 0;
+
+    // Decode the message on `text`, the buffer contents might be modified.
+    virtual bool decode(char* text, size_t length, programaker_message* message) = 0;
+
+    // Arguments of the last decoded FUNCTION_CALL
+    virtual JSONVar arguments() = 0;
+
+    virtual String encode_authentication(const String& token) = 0;
+    virtual String encode_notification(const String& key, const JSONVar& value) = 0;
+    // Notification with the changed fields only, see signal_delta.hpp
+    virtual String encode_delta_notification(const String& key, const JSONVar& delta) = 0;
+    virtual String encode_response(const char* message_id, const JSONVar& result) = 0;
+};
+
+
+class JSONVarCodec : public ProgramakerCodec {
+    JSONVar last;
+
+public:
+    const char* name() {
+        return "Arduino_JSON";
+    }
+
+    bool decode(char* text, size_t length, programaker_message* message) {
+        // JSON.parse() needs a null-terminated string, and there might not
+        // be space for the terminator on `text`
+        char* terminated = (char*) malloc(length + 1);
+        if (terminated == NULL) {
+            return false;
+        }
+        memcpy(terminated, text, length);
+        terminated[length] = '\0';
+
+        last = JSON.parse(terminated);
+        free(terminated);
+        if (JSON.typeof_(last) != "object") {
+            return false;
+        }
+
+        message->type = (const char*) last["type"];
+        message->message_id = (const char*) last["message_id"];
+        message->function_name = (const char*) last["value"]["function_name"];
+
+        return true;
+    }
+
+    JSONVar arguments() {
+        return last["value"]["arguments"];
+    }
+
+    String encode_authentication(const String& token) {
+        JSONVar doc;
+        doc["type"] = "AUTHENTICATION";
+
+        JSONVar value;
+        value["token"] = token;
+        doc["value"] = value;
+
+        return JSON.stringify(doc);
+    }
+
+    String encode_notification(const String& key, const JSONVar& value) {
+        JSONVar doc;
+        JSONVar to_user; // Null
+        doc["type"] = "NOTIFICATION";
+        doc["key"] = key;
+        doc["to_user"] = to_user;
+
+        // @TODO Separate content and value
+        doc["content"] = value;
+        doc["value"] = value;
+
+        return JSON.stringify(doc);
+    }
+
+    String encode_delta_notification(const String& key, const JSONVar& delta) {
+        JSONVar doc;
+        JSONVar to_user; // Null
+        doc["type"] = "NOTIFICATION";
+        doc["key"] = key;
+        doc["to_user"] = to_user;
+        doc["delta"] = true;
+
+        // Same envelope as encode_notification()
+        doc["content"] = delta;
+        doc["value"] = delta;
+
+        return JSON.stringify(doc);
+    }
+
+    String encode_response(const char* message_id, const JSONVar& result) {
+        JSONVar response;
+        response["message_id"] = message_id;
+        response["success"] = true;
+        response["result"] = result;
+
+        return JSON.stringify(response);
+    }
+};
+
+
+// Minimal JSON scanning, used by MinimalCodec.
+// All functions return the position after the scanned element, or NULL if
+// the input is not valid.
+const char* json_skip_whitespace(const char* p, const char* end) {
+    while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\n') || (*p == '\r'))) {
+        p++;
+    }
+    return p;
+}
+
+const char* json_skip_string(const char* p, const char* end) {
+    if ((p >= end) || (*p != '"')) {
+        return NULL;
+    }
+
+    for (p++; p < end; p++) {
+        if (*p == '\\') {
+            p++;
+            if ((p >= end) || (strchr("\"\\/bfnrtu", *p) == NULL) || (*p == '\0')) {
+                return NULL;
+            }
+            if (*p == 'u') {
+                for (int i = 0; i < 4; i++) {
+                    p++;
+                    if ((p >= end) || (!isxdigit((unsigned char) *p))) {
+                        return NULL;
+                    }
+                }
+            }
+        }
+        else if (*p == '"') {
+            return p + 1;
+        }
+        else if ((unsigned char) *p < 0x20) {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+const char* json_skip_literal(const char* p, const char* end, const char* literal) {
+    size_t length = strlen(literal);
+    if ((((size_t) (end - p)) < length) || (strncmp(p, literal, length) != 0)) {
+        return NULL;
+    }
+    return p + length;
+}
+
+const char* json_skip_digits(const char* p, const char* end) {
+    const char* start = p;
+    while ((p < end) && (*p >= '0') && (*p <= '9')) {
+        p++;
+    }
+    return (p > start) ? p : NULL;
+}
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+const char* json_skip_number(const char* p, const char* end) {
+    if ((p < end) && (*p == '-')) {
+        p++;
+    }
+
+    if ((p < end) && (*p == '0')) {
+        p++;
+    }
+    else {
+        p = json_skip_digits(p, end);
+        if (p == NULL) {
+            return NULL;
+        }
+    }
+
+    if ((p < end) && (*p == '.')) {
+        p = json_skip_digits(p + 1, end);
+        if (p == NULL) {
+            return NULL;
+        }
+    }
+
+    if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+        p++;
+        if ((p < end) && ((*p == '+') || (*p == '-'))) {
+            p++;
+        }
+        p = json_skip_digits(p, end);
+    }
+    return p;
+}
+
+const char* json_skip_value(const char* p, const char* end, int depth) {
+    p = json_skip_whitespace(p, end);
+    if (p >= end) {
+        return NULL;
+    }
+
+    if (*p == '"') {
+        return json_skip_string(p, end);
+    }
+
+    if ((*p == '{') || (*p == '[')) {
+        if (depth <= 0) {
+            return NULL;
+        }
+
+        bool is_object = (*p == '{');
+        char close = is_object ? '}' : ']';
+        p = json_skip_whitespace(p + 1, end);
+        if ((p < end) && (*p == close)) {
+            return p + 1;
+        }
+
+        while (p < end) {
+            if (is_object) {
+                p = json_skip_string(json_skip_whitespace(p, end), end);
+                if (p == NULL) {
+                    return NULL;
+                }
+                p = json_skip_whitespace(p, end);
+                if ((p >= end) || (*p != ':')) {
+                    return NULL;
+                }
+                p++;
+            }
+
+            p = json_skip_value(p, end, depth - 1);
+            if (p == NULL) {
+                return NULL;
+            }
+
+            p = json_skip_whitespace(p, end);
+            if ((p < end) && (*p == ',')) {
+                p++;
+            }
+            else if ((p < end) && (*p == close)) {
+                return p + 1;
+            }
+            else {
+                return NULL;
+            }
+        }
+        return NULL;
+    }
+
+    if (*p == 't') {
+        return json_skip_literal(p, end, "true");
+    }
+    if (*p == 'f') {
+        return json_skip_literal(p, end, "false");
+    }
+    if (*p == 'n') {
+        return json_skip_literal(p, end, "null");
+    }
+    return json_skip_number(p, end);
+}
+
+// Compare a scanned key (including the quotes) with `name`
+bool json_key_is(const char* key, const char* key_end, const char* name) {
+    size_t length = strlen(name);
+    return (((size_t) (key_end - key)) == (length + 2))
+        && (strncmp(key + 1, name, length) == 0);
+}
+
+void json_append_utf8(char** out, uint32_t code) {
+    char* w = *out;
+    if (code < 0x80) {
+        *w++ = code;
+    }
+    else if (code < 0x800) {
+        *w++ = 0xC0 | (code >> 6);
+        *w++ = 0x80 | (code & 0x3F);
+    }
+    else if (code < 0x10000) {
+        *w++ = 0xE0 | (code >> 12);
+        *w++ = 0x80 | ((code >> 6) & 0x3F);
+        *w++ = 0x80 | (code & 0x3F);
+    }
+    else {
+        *w++ = 0xF0 | (code >> 18);
+        *w++ = 0x80 | ((code >> 12) & 0x3F);
+        *w++ = 0x80 | ((code >> 6) & 0x3F);
+        *w++ = 0x80 | (code & 0x3F);
+    }
+    *out = w;
+}
+
+// Unescape the string starting at `p` in place, and null-terminate it.
+// The result is written from the opening quote on, it is never longer than
+// the escaped contents so it always fits before the closing quote.
+char* json_unescape_string(char* p, const char* end) {
+    char* w = p;
+    for (p++; p < end; p++) {
+        if (*p == '"') {
+            *w = '\0';
+            return p + 1;
+        }
+
+        if (*p != '\\') {
+            *w++ = *p;
+            continue;
+        }
+
+        p++;
+        if (p >= end) {
+            return NULL;
+        }
+
+        switch (*p) {
+        case 'b': *w++ = '\b'; break;
+        case 'f': *w++ = '\f'; break;
+        case 'n': *w++ = '\n'; break;
+        case 'r': *w++ = '\r'; break;
+        case 't': *w++ = '\t'; break;
+        case 'u':
+        {
+            if ((end - p) < 5) {
+                return NULL;
+            }
+            char hex[5] = { p[1], p[2], p[3], p[4], '\0' };
+            uint32_t code = strtoul(hex, NULL, 16);
+            p += 4;
+
+            // Surrogate pair
+            if ((code >= 0xD800) && (code < 0xDC00) && ((end - p) >= 7)
+                && (p[1] == '\\') && (p[2] == 'u')) {
+                char low_hex[5] = { p[3], p[4], p[5], p[6], '\0' };
+                uint32_t low = strtoul(low_hex, NULL, 16);
+                if ((low >= 0xDC00) && (low < 0xE000)) {
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+            }
+            json_append_utf8(&w, code);
+        }
+        break;
+
+        default:
+            // '"', '\\' and '/'
+            *w++ = *p;
+        }
+    }
+    return NULL;
+}
+
+void json_append_string(String& out, const char* str) {
+    if (str == NULL) {
+        out += "null";
+        return;
+    }
+
+    out += '"';
+    for (; *str != '\0'; str++) {
+        switch (*str) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if ((unsigned char) *str < 0x20) {
+                char escaped[7];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", *str);
+                out += escaped;
+            }
+            else {
+                out += *str;
+            }
+        }
+    }
+    out += '"';
+}
+
+#define MINIMAL_CODEC_MAX_DEPTH 16
+
+class MinimalCodec : public ProgramakerCodec {
+    const char* arguments_start = NULL;
+
+public:
+    const char* name() {
+        return "Minimal";
+    }
+
+    bool decode(char* text, size_t length, programaker_message* message) {
+        const char* end = text + length;
+        char* arguments_end = NULL;
+
+        message->type = NULL;
+        message->message_id = NULL;
+        message->function_name = NULL;
+        arguments_start = NULL;
+
+        char* p = (char*) json_skip_whitespace(text, end);
+        if ((p >= end) || (*p != '{')) {
+            return false;
+        }
+        p++;
+
+        // Top level fields, and the ones inside "value"
+        bool in_value = false;
+        while (true) {
+            p = (char*) json_skip_whitespace(p, end);
+            if ((p < end) && (*p == '}')) {
+                if (!in_value) {
+                    break;
+                }
+                in_value = false;
+                p++;
+            }
+            else {
+                const char* key = p;
+                p = (char*) json_skip_string(p, end);
+                if (p == NULL) {
+                    return false;
+                }
+                const char* key_end = p;
+
+                p = (char*) json_skip_whitespace(p, end);
+                if ((p >= end) || (*p != ':')) {
+                    return false;
+                }
+                p = (char*) json_skip_whitespace(p + 1, end);
+                if (p >= end) {
+                    return false;
+                }
+
+                const char** string_field = NULL;
+                if (!in_value && json_key_is(key, key_end, "type")) {
+                    string_field = &message->type;
+                }
+                else if (!in_value && json_key_is(key, key_end, "message_id")) {
+                    string_field = &message->message_id;
+                }
+                else if (in_value && json_key_is(key, key_end, "function_name")) {
+                    string_field = &message->function_name;
+                }
+
+                if ((string_field != NULL) && (*p == '"')) {
+                    *string_field = p;
+                    p = json_unescape_string(p, end);
+                }
+                else if (!in_value && (*p == '{') && json_key_is(key, key_end, "value")) {
+                    in_value = true;
+                    p++;
+                    continue;
+                }
+                else {
+                    char* value = p;
+                    p = (char*) json_skip_value(p, end, MINIMAL_CODEC_MAX_DEPTH);
+                    if (in_value && (p != NULL) && json_key_is(key, key_end, "arguments")) {
+                        arguments_start = value;
+                        arguments_end = p;
+                    }
+                }
+
+                if (p == NULL) {
+                    return false;
+                }
+            }
+
+            p = (char*) json_skip_whitespace(p, end);
+            if ((p < end) && (*p == ',')) {
+                p++;
+            }
+            else if ((p >= end) || (*p != '}')) {
+                return false;
+            }
+        }
+
+        // Scanning is done, the arguments can be terminated in place
+        if (arguments_end != NULL) {
+            *arguments_end = '\0';
+        }
+        return true;
+    }
+
+    JSONVar arguments() {
+        if (arguments_start == NULL) {
+            return JSON.parse("[]");
+        }
+        return JSON.parse(arguments_start);
+    }
+
+    String encode_authentication(const String& token) {
+        String out;
+        out.reserve(token.length() + 48);
+        out += "{\"type\":\"AUTHENTICATION\",\"value\":{\"token\":";
+        json_append_string(out, token.c_str());
+        out += "}}";
+        return out;
+    }
+
+    String encode_notification(const String& key, const JSONVar& value) {
+        String serialized = JSON.stringify(value);
+
+        String out;
+        out.reserve(key.length() + (serialized.length() * 2) + 80);
+        out += "{\"type\":\"NOTIFICATION\",\"key\":";
+        json_append_string(out, key.c_str());
+        out += ",\"to_user\":null,\"content\":";
+        out += serialized;
+        out += ",\"value\":";
+        out += serialized;
+        out += '}';
+        return out;
+    }
+
+    String encode_delta_notification(const String& key, const JSONVar& delta) {
+        String serialized = JSON.stringify(delta);
+
+        String out;
+        out.reserve(key.length() + (serialized.length() * 2) + 96);
+        out += "{\"type\":\"NOTIFICATION\",\"key\":";
+        json_append_string(out, key.c_str());
+        out += ",\"to_user\":null,\"delta\":true,\"content\":";
+        out += serialized;
+        out += ",\"value\":";
+        out += serialized;
+        out += '}';
+        return out;
+    }
+
+    String encode_response(const char* message_id, const JSONVar& result) {
+        String serialized = JSON.stringify(result);
+
+        String out;
+        out.reserve(serialized.length() + 64);
+        out += "{\"message_id\":";
+        json_append_string(out, message_id);
+        out += ",\"success\":true,\"result\":";
+        out += serialized;
+        out += '}';
+        return out;
+    }
+};
+
+
+#ifdef PROGRAMAKER_CODEC_ARDUINOJSON
+#include <ArduinoJson.h>
+
+#ifndef ARDUINOJSON_CODEC_DOC_SIZE
+#define ARDUINOJSON_CODEC_DOC_SIZE 1024
+#endif
+
+class ArduinoJsonCodec : public ProgramakerCodec {
+    // Input strings are not copied, they point to the decoded text
+    StaticJsonDocument<ARDUINOJSON_CODEC_DOC_SIZE> input;
+    StaticJsonDocument<256> output;
+
+public:
+    const char* name() {
+        return "ArduinoJson";
+    }
+
+    bool decode(char* text, size_t length, programaker_message* message) {
+        DeserializationError error = deserializeJson(input, text, length);
+        if (error || !input.is<JsonObject>()) {
+            return false;
+        }
+
+        message->type = input["type"].as<const char*>();
+        message->message_id = input["message_id"].as<const char*>();
+        message->function_name = input["value"]["function_name"].as<const char*>();
+
+        return true;
+    }
+
+    JSONVar arguments() {
+        String serialized;
+        serializeJson(input["value"]["arguments"], serialized);
+        return JSON.parse(serialized);
+    }
+
+    String encode_authentication(const String& token) {
+        output.clear();
+        output["type"] = "AUTHENTICATION";
+        output["value"]["token"] = token.c_str();
+
+        String out;
+        serializeJson(output, out);
+        return out;
+    }
+
+    String encode_notification(const String& key, const JSONVar& value) {
+        String serialized_value = JSON.stringify(value);
+
+        output.clear();
+        output["type"] = "NOTIFICATION";
+        output["key"] = key.c_str();
+        output["to_user"] = nullptr;
+        // Linked, not copied into the document
+        output["content"] = serialized(serialized_value.c_str(), serialized_value.length());
+        output["value"] = serialized(serialized_value.c_str(), serialized_value.length());
+
+        String out;
+        serializeJson(output, out);
+        return out;
+    }
+
+    String encode_delta_notification(const String& key, const JSONVar& delta) {
+        String serialized_delta = JSON.stringify(delta);
+
+        output.clear();
+        output["type"] = "NOTIFICATION";
+        output["key"] = key.c_str();
+        output["to_user"] = nullptr;
+        output["delta"] = true;
+        output["content"] = serialized(serialized_delta.c_str(), serialized_delta.length());
+        output["value"] = serialized(serialized_delta.c_str(), serialized_delta.length());
+
+        String out;
+        serializeJson(output, out);
+        return out;
+    }
+
+    String encode_response(const char* message_id, const JSONVar& result) {
+        String serialized_result = JSON.stringify(result);
+
+        output.clear();
+        output["message_id"] = message_id;
+        output["success"] = true;
+        output["result"] = serialized(serialized_result.c_str(), serialized_result.length());
+
+        String out;
+        serializeJson(output, out);
+        return out;
+    }
+};
+#endif
@@ -0,0 +1,121 @@
+#include <Arduino_JSON.h>
+
+// Field-level delta encoding of object-valued signals.
+//
+// The last value sent for each key is kept, and only the fields that changed
+// since then are sent. Nested objects are compared field by field too, any
+// other value (numbers, strings, arrays...) is sent whole when it changes.
+//
+// A full value (keyframe) is sent for the first update of a key, every
+// SIGNAL_DELTA_KEYFRAME_INTERVAL updates, and when a field is removed, as
+// removals can't be expressed as a delta. Values that are not objects are
+// always sent whole.
+//
+// Receivers reconstruct the value merging each delta into the last keyframe,
+// see DeltaReceiver on tools/programaker_stand_in.py. PrograMaker doesn't do
+// this, so the bridge only uses it with PROGRAMAKER_SIGNAL_DELTA defined.
+
+#define SIGNAL_DELTA_MAX_KEYS 4
+#define SIGNAL_DELTA_KEYFRAME_INTERVAL 20
+
+class SignalDelta {
+    String keys[SIGNAL_DELTA_MAX_KEYS];
+    JSONVar last[SIGNAL_DELTA_MAX_KEYS]; // Last value sent, as the receiver has it
+    unsigned int since_keyframe[SIGNAL_DELTA_MAX_KEYS];
+    size_t key_count = 0;
+
+public:
+    unsigned long keyframes = 0;
+    unsigned long deltas = 0;
+
+    // Returns true if `value` has to be sent whole. If not `delta` is set
+    // with the changed fields.
+    bool update(const String& key, JSONVar& value, JSONVar* delta) {
+        if (JSON.typeof_(value) != "object") {
+            return true;
+        }
+
+        int index = this->find(key);
+        if (index < 0) {
+            if (this->key_count >= SIGNAL_DELTA_MAX_KEYS) {
+                // No space to track it
+                return true;
+            }
+            index = this->key_count++;
+            this->keys[index] = key;
+            this->since_keyframe[index] = SIGNAL_DELTA_KEYFRAME_INTERVAL;
+        }
+
+        *delta = JSON.parse("{}");
+        bool keyframe = ((this->since_keyframe[index] >= SIGNAL_DELTA_KEYFRAME_INTERVAL)
+                         || (!diff(this->last[index], value, *delta)));
+
+        this->last[index] = value;
+        if (keyframe) {
+            this->since_keyframe[index] = 0;
+            this->keyframes++;
+        }
+        else {
+            this->since_keyframe[index]++;
+            this->deltas++;
+        }
+        return keyframe;
+    }
+
+    // The receiver might have lost the last values (on a reconnection, or
+    // if they were sent some other way), start with keyframes again
+    void reset() {
+        for (size_t i = 0; i < this->key_count; i++) {
+            this->since_keyframe[i] = SIGNAL_DELTA_KEYFRAME_INTERVAL;
+        }
+    }
+
+private:
+    int find(const String& key) {
+        for (size_t i = 0; i < this->key_count; i++) {
+            if (this->keys[i] == key) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Add to `delta` the fields of `value` that are different on `previous`.
+    // Returns false if it can't be expressed as a delta.
+    static bool diff(JSONVar& previous, JSONVar& value, JSONVar& delta) {
+        JSONVar previous_keys = previous.keys();
+        for (int i = 0; i < previous_keys.length(); i++) {
+            if (!value.hasOwnProperty((const char*) previous_keys[i])) {
+                return false;
+            }
+        }
+
+        JSONVar keys = value.keys();
+        for (int i = 0; i < keys.length(); i++) {
+            const char* field = (const char*) keys[i];
+            JSONVar field_value = value[field];
+
+            if (!previous.hasOwnProperty(field)) {
+                delta[field] = field_value;
+                continue;
+            }
+
+            JSONVar previous_value = previous[field];
+            if ((JSON.typeof_(field_value) == "object")
+                && (JSON.typeof_(previous_value) == "object")) {
+                JSONVar nested = JSON.parse("{}");
+                if (!diff(previous_value, field_value, nested)) {
+                    return false;
+                }
+                if (nested.keys().length() > 0) {
+                    delta[field] = nested;
+                }
+            }
+            else if (JSON.stringify(field_value) != JSON.stringify(previous_value)) {
+                delta[field] = field_value;
+            }
+        }
+
+        return true;
+    }
+};
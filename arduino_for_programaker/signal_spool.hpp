@@ -0,0 +1,184 @@
+#include <FS.h>
+
+// Append-only log of the signals sent while the connection is down.
+//
+// Records are stored as `key\tvalue\n` lines on a ring of segment files,
+// when the ring is full the oldest segment is dropped. To reduce flash wear
+// the records are staged on RAM and written in chunks, either when enough
+// bytes are accumulated or every SPOOL_FLUSH_INTERVAL_MS.
+//
+// The read position is only kept in RAM, a segment is removed when it has
+// been completely drained. So, if the device restarts in the middle of a
+// drain, the records of that segment will be sent again.
+//
+// Any fs::FS works as backend, LittleFS on the device or the file-backed one
+// of the ESP8266 host emulation.
+
+#define SPOOL_DIR "/spool"
+#define SPOOL_SEGMENT_SIZE 4096
+#define SPOOL_MAX_SEGMENTS 8
+#define SPOOL_STAGING_SIZE 512
+#define SPOOL_FLUSH_INTERVAL_MS 5000
+
+class SignalSpool {
+    fs::FS *fs;
+    uint32_t first_segment = 0; // Oldest segment with pending records
+    uint32_t last_segment = 0;  // Segment where records are appended
+    size_t last_segment_size = 0; // Including the staged bytes
+    size_t read_offset = 0;     // Position on first_segment
+    String staging;
+    unsigned long last_flush = 0;
+
+public:
+    unsigned long dropped_segments = 0;
+
+    SignalSpool(fs::FS *fs) {
+        this->fs = fs;
+    }
+
+    // Look for the segments left by a previous run
+    bool begin() {
+        fs->mkdir(SPOOL_DIR);
+
+        File dir = fs->open(SPOOL_DIR, "r");
+        if (!dir || !dir.isDirectory()) {
+            Serial.println("[Spool] Cannot open " SPOOL_DIR);
+            return false;
+        }
+
+        bool found = false;
+        File file;
+        while ((file = dir.openNextFile())) {
+            String name = file.name();
+            uint32_t id = name.substring(name.lastIndexOf('/') + 1).toInt();
+
+            if ((!found) || (id < first_segment)) {
+                first_segment = id;
+            }
+            if ((!found) || (id >= last_segment)) {
+                last_segment = id;
+                last_segment_size = file.size();
+            }
+            found = true;
+            file.close();
+        }
+
+        read_offset = 0;
+        Serial.printf("[Spool] Segments %u-%u pending\n",
+                      first_segment, last_segment);
+        return true;
+    }
+
+    bool has_pending() {
+        return (first_segment != last_segment) || (last_segment_size > read_offset);
+    }
+
+    void append(const String& key, const String& value) {
+        size_t record_size = key.length() + value.length() + 2;
+
+        if ((last_segment_size > 0)
+            && ((last_segment_size + record_size) > SPOOL_SEGMENT_SIZE)) {
+            flush();
+            rotate();
+        }
+
+        staging += key;
+        staging += '\t';
+        staging += value;
+        staging += '\n';
+        last_segment_size += record_size;
+
+        if (staging.length() >= SPOOL_STAGING_SIZE) {
+            flush();
+        }
+    }
+
+    // Periodically move the staged records to flash
+    void loop() {
+        if ((staging.length() > 0)
+            && ((millis() - last_flush) >= SPOOL_FLUSH_INTERVAL_MS)) {
+            flush();
+        }
+    }
+
+    // Read up to `max_records` pending records, calling `callback` for each one.
+    // The callback returns whether the record was sent, if not the drain
+    // stops and the record is kept to be retried.
+    // Returns the number of records sent.
+    template <typename F>
+    size_t drain(size_t max_records, F callback) {
+        flush();
+
+        size_t count = 0;
+        bool failed = false;
+        while ((!failed) && (count < max_records) && has_pending()) {
+            File file = fs->open(segment_path(first_segment), "r");
+            size_t segment_size = 0;
+            if (file) {
+                segment_size = file.size();
+                file.seek(read_offset, SeekSet);
+                while ((count < max_records) && (read_offset < segment_size)) {
+                    String key = file.readStringUntil('\t');
+                    String value = file.readStringUntil('\n');
+
+                    if (!callback(key, value)) {
+                        failed = true;
+                        break;
+                    }
+                    read_offset = file.position();
+                    count++;
+                }
+                file.close();
+            }
+
+            if ((!failed) && (read_offset >= segment_size)) {
+                // Segment fully drained
+                fs->remove(segment_path(first_segment));
+                if (first_segment == last_segment) {
+                    last_segment++;
+                    last_segment_size = 0;
+                }
+                first_segment++;
+                read_offset = 0;
+            }
+        }
+
+        return count;
+    }
+
+private:
+    String segment_path(uint32_t id) {
+        return String(SPOOL_DIR "/") + String(id);
+    }
+
+    void flush() {
+        last_flush = millis();
+        if (staging.length() == 0) {
+            return;
+        }
+
+        File file = fs->open(segment_path(last_segment), "a");
+        if (!file) {
+            Serial.println("[Spool] Cannot write segment, dropping records");
+            last_segment_size -= staging.length();
+        }
+        else {
+            file.print(staging);
+            file.close();
+        }
+        staging = "";
+    }
+
+    void rotate() {
+        last_segment++;
+        last_segment_size = 0;
+
+        if ((last_segment - first_segment) >= SPOOL_MAX_SEGMENTS) {
+            fs->remove(segment_path(first_segment));
+            first_segment++;
+            read_offset = 0;
+            dropped_segments++;
+            Serial.println("[Spool] Full, oldest segment dropped");
+        }
+    }
+};
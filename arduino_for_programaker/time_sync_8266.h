@@ -0,0 +1,113 @@
+#ifdef DEVICE_ESP8266
+
+#include <NTPClient.h>
+#include <WiFiUdp.h>
+#include <sys/time.h>
+
+// The clock is only needed to validate the server certificate, so it
+// doesn't have to be precise. Instead of doing an NTP round trip before
+// every connection, the time is kept on the RTC user memory (which
+// survives soft resets) and refreshed from NTP every NTP_REFRESH_SECONDS.
+#define NTP_REFRESH_SECONDS (6 * 60 * 60)
+#define RTC_TIME_SAVE_SECONDS 60
+#define RTC_TIME_MAGIC 0x50524d4b // "PRMK"
+#define RTC_TIME_BLOCK 0 // Offset on the RTC user memory, in 4-byte blocks
+
+typedef struct {
+    uint32_t magic;
+    uint32_t last_sync; // Epoch of the last NTP update
+    uint32_t saved_at;  // Epoch when the record was written
+    uint32_t checksum;
+} rtc_time_record;
+
+// Define NTP Client to get time
+WiFiUDP ntpUDP;
+const long utcOffsetInSeconds = 0; // We consider timezone=UTC+0
+NTPClient timeClient(ntpUDP, "pool.ntp.org", utcOffsetInSeconds);
+
+rtc_time_record rtc_time = { 0 };
+
+uint32_t rtc_time_checksum(const rtc_time_record *record) {
+    return record->magic ^ record->last_sync ^ (record->saved_at * 2654435761u);
+}
+
+void save_rtc_time() {
+    rtc_time.magic = RTC_TIME_MAGIC;
+    rtc_time.saved_at = time(NULL);
+    rtc_time.checksum = rtc_time_checksum(&rtc_time);
+
+    ESP.rtcUserMemoryWrite(RTC_TIME_BLOCK, (uint32_t*) &rtc_time, sizeof(rtc_time));
+}
+
+void set_time(uint32_t epoch) {
+    struct timeval realtime;
+    realtime.tv_sec = epoch;
+    realtime.tv_usec = 0;
+    settimeofday(&realtime, NULL);
+}
+
+bool sync_ntp_time() {
+    if (!timeClient.forceUpdate()) {
+        Serial.println("NTP update failed");
+        return false;
+    }
+
+    set_time(timeClient.getEpochTime());
+    rtc_time.last_sync = timeClient.getEpochTime();
+    save_rtc_time();
+
+    return true;
+}
+
+void print_time() {
+    time_t t = time(NULL);
+    struct tm tm = *localtime(&t);
+    Serial.printf("=> Current time: %i/%i/%i %i:%i:%i\n", tm.tm_year + 1900,
+                  tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+// Restore the clock from the RTC memory, only going to NTP if there's no
+// usable value there. The restored time lags behind for as long as the reset
+// took, which is fine for certificate validation.
+void setup_time() {
+    timeClient.begin();
+
+    ESP.rtcUserMemoryRead(RTC_TIME_BLOCK, (uint32_t*) &rtc_time, sizeof(rtc_time));
+    bool valid = ((rtc_time.magic == RTC_TIME_MAGIC)
+                  && (rtc_time.checksum == rtc_time_checksum(&rtc_time)));
+
+    if (valid && ((rtc_time.saved_at - rtc_time.last_sync) < NTP_REFRESH_SECONDS)) {
+        set_time(rtc_time.saved_at);
+        Serial.println("Time restored from RTC memory");
+    }
+    else {
+        rtc_time.last_sync = 0;
+        sync_ntp_time();
+    }
+
+    print_time();
+}
+
+// Keep the RTC copy up to date and refresh from NTP when it gets too old
+void time_sync_loop() {
+    static uint32_t last_save = 0;
+    static uint32_t ntp_retry_at = 0;
+
+    uint32_t now = time(NULL);
+    bool needs_sync = ((rtc_time.last_sync == 0)
+                       || ((now - rtc_time.last_sync) >= NTP_REFRESH_SECONDS));
+
+    if (needs_sync && (now >= ntp_retry_at)) {
+        if (!sync_ntp_time()) {
+            // Don't block every loop on a failing NTP server
+            ntp_retry_at = now + RTC_TIME_SAVE_SECONDS;
+        }
+        last_save = now;
+    }
+    else if ((now - last_save) >= RTC_TIME_SAVE_SECONDS) {
+        save_rtc_time();
+        last_save = now;
+    }
+}
+
+#endif
@@ -0,0 +1,222 @@
+// Compare the codecs on programaker_codec.hpp with PrograMaker messages.
+//
+// For each codec and message prints the time per operation and the peak heap
+// used (ESP8266 core >= 3.0, which keeps heap statistics). Then measures the
+// permessage-deflate compression ratio and cost for the larger frames, alone
+// and as a stream of changing sensor updates, and the bytes per update of the
+// delta encoded signals against whole values.
+//
+// tools/bench/codec_bench.sh runs it on the host too, with the code size of
+// each codec.
+
+#define PROGRAMAKER_CODEC_ARDUINOJSON
+#include "programaker_codec.hpp"
+#include "permessage_deflate.hpp"
+#include "signal_delta.hpp"
+#include <umm_malloc/umm_malloc.h>
+
+#define ITERATIONS 1000
+
+// Received messages
+const char FUNCTION_CALL_MESSAGE[] PROGMEM = R"EOF({"type":"FUNCTION_CALL","message_id":"8b3e5a1e-4c1d-4f4e-9a4b-0d6b3f1a7c22","value":{"function_name":"set_left_bar","arguments":["255","128","0"]},"user_id":"3c1f0a9e-5b2d-4e6f-8a7b-1c2d3e4f5a6b","extra_data":{}})EOF";
+const char REGISTRATION_MESSAGE[] PROGMEM = R"EOF({"type":"REGISTRATION","message_id":"0f6c2d4b-8a1e-4b3c-9d5e-7f8a9b0c1d2e","value":{"metadata":{"user_id":"3c1f0a9e-5b2d-4e6f-8a7b-1c2d3e4f5a6b"}}})EOF";
+const char CONFIGURATION_MESSAGE[] PROGMEM = R"EOF({"type":"CONFIGURATION","value":{"is_public":false,"service_name":"M5Stack","icon":{"url":"https://avatars.githubusercontent.com/u/9460735"},"blocks":[{"id":"on_sensor_signal","function_name":"on_sensor_signal","key":"on_sensor_signal","block_type":"trigger","message":"On sensor update. Set %1","expected_value":null,"save_to":{"type":"argument","index":0},"arguments":[{"type":"variable","class":"single"}]},{"id":"get_sensors","function_name":"get_sensors","block_type":"getter","block_result_type":null,"message":"Get sensors","arguments":[]},{"id":"set_left_bar","function_name":"set_left_bar","block_type":"operation","block_result_type":null,"message":"Color left bar (r:%1, g:%2, b:%3)","arguments":[{"type":"integer","default":"255"},{"type":"integer","default":"255"},{"type":"integer","default":"255"}]},{"id":"print_line","function_name":"print_line","block_type":"operation","block_result_type":null,"message":"Print line: %1","arguments":[{"type":"string","default":"Hello!"}]}]}})EOF";
+
+JSONVar sensors_value() {
+    JSONVar value;
+    JSONVar gyro;
+    gyro["x"] = 1.25;
+    gyro["y"] = -0.5;
+    gyro["z"] = 0.125;
+
+    JSONVar acc;
+    acc["x"] = 0.01;
+    acc["y"] = 0.02;
+    acc["z"] = 0.98;
+
+    JSONVar ahrs;
+    ahrs["pitch"] = 3.5;
+    ahrs["roll"] = -1.25;
+    ahrs["yaw"] = 90.0;
+
+    value["gyro"] = gyro;
+    value["acc"] = acc;
+    value["ahrs"] = ahrs;
+    value["temp"] = 31;
+    value["battery"] = 75;
+
+    return value;
+}
+
+void print_result(ProgramakerCodec *codec, const char* operation,
+                  unsigned long start, size_t heap_before) {
+    unsigned long elapsed = micros() - start;
+    size_t peak = heap_before - umm_free_heap_size_min();
+
+    Serial.printf("%-14s %-24s %8.2f us/op %8u bytes peak heap\n",
+                  codec->name(), operation, (float) elapsed / ITERATIONS, peak);
+}
+
+void bench_decode(ProgramakerCodec *codec, const char* operation,
+                  PGM_P message, bool with_arguments) {
+    size_t length = strlen_P(message);
+    char* buffer = (char*) malloc(length + 1);
+
+    size_t heap_before = ESP.getFreeHeap();
+    umm_free_heap_size_min_reset();
+    unsigned long start = micros();
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        // Decoding is done in place, start from a clean copy each time
+        memcpy_P(buffer, message, length + 1);
+
+        programaker_message decoded;
+        codec->decode(buffer, length, &decoded);
+        if (with_arguments) {
+            JSONVar arguments = codec->arguments();
+        }
+    }
+
+    print_result(codec, operation, start, heap_before);
+    free(buffer);
+}
+
+void bench_codec(ProgramakerCodec *codec) {
+    bench_decode(codec, "decode FUNCTION_CALL", FUNCTION_CALL_MESSAGE, true);
+    bench_decode(codec, "decode REGISTRATION", REGISTRATION_MESSAGE, false);
+    bench_decode(codec, "decode CONFIGURATION", CONFIGURATION_MESSAGE, false);
+
+    JSONVar value = sensors_value();
+    size_t heap_before = ESP.getFreeHeap();
+    umm_free_heap_size_min_reset();
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        String encoded = codec->encode_notification("on_sensor_signal", value);
+    }
+    print_result(codec, "encode NOTIFICATION", start, heap_before);
+
+    JSONVar result = nullptr;
+    heap_before = ESP.getFreeHeap();
+    umm_free_heap_size_min_reset();
+    start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        String encoded = codec->encode_response("8b3e5a1e-4c1d-4f4e-9a4b-0d6b3f1a7c22", result);
+    }
+    print_result(codec, "encode response", start, heap_before);
+}
+
+// Compression of a single message without history, as the first message of
+// a connection
+void bench_deflate(const char* operation, const String& message) {
+    DeflateEncoder *encoder = new DeflateEncoder();
+    encoder->context_takeover = false;
+    uint8_t* compressed = (uint8_t*) malloc(DeflateEncoder::max_compressed_size(message.length()));
+
+    size_t compressed_length = 0;
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        compressed_length = encoder->compress((const uint8_t*) message.c_str(),
+                                              message.length(), compressed);
+    }
+    unsigned long elapsed = micros() - start;
+
+    Serial.printf("deflate %-24s %5u -> %5u bytes %8.2f us/op\n",
+                  operation, message.length(), compressed_length,
+                  (float) elapsed / ITERATIONS);
+
+    free(compressed);
+    delete encoder;
+}
+
+// Sensor readings at update `i`: the yaw changes on every update and the
+// temperature every 10
+void update_sensors_value(JSONVar& value, int i) {
+    value["ahrs"]["yaw"] = (double) (i % 360);
+    if ((i % 10) == 0) {
+        value["temp"] = 31 + ((i / 10) % 3);
+    }
+}
+
+// Compression of consecutive sensor updates sharing the window, as with
+// context takeover. Only the compression is timed.
+void bench_deflate_stream(ProgramakerCodec *codec) {
+    DeflateEncoder *encoder = new DeflateEncoder();
+    JSONVar value = sensors_value();
+    String message = codec->encode_notification("on_sensor_signal", value);
+    // With room for longer values than the first ones
+    uint8_t* compressed = (uint8_t*) malloc(DeflateEncoder::max_compressed_size(message.length() * 2));
+
+    unsigned long message_bytes = 0;
+    unsigned long compressed_bytes = 0;
+    unsigned long elapsed = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+        update_sensors_value(value, i);
+        message = codec->encode_notification("on_sensor_signal", value);
+
+        unsigned long start = micros();
+        compressed_bytes += encoder->compress((const uint8_t*) message.c_str(),
+                                              message.length(), compressed);
+        elapsed += micros() - start;
+        message_bytes += message.length();
+    }
+
+    Serial.printf("deflate %-24s %5lu -> %5lu bytes/update (%lu%%) %8.2f us/op\n",
+                  "sensor updates", message_bytes / ITERATIONS, compressed_bytes / ITERATIONS,
+                  (compressed_bytes * 100) / message_bytes, (float) elapsed / ITERATIONS);
+
+    free(compressed);
+    delete encoder;
+}
+
+// Sensor updates where only some of the fields change each time
+void bench_delta(ProgramakerCodec *codec) {
+    SignalDelta delta;
+    JSONVar value = sensors_value();
+
+    unsigned long full_bytes = 0;
+    unsigned long sent_bytes = 0;
+    unsigned long start = micros();
+    for (int i = 0; i < ITERATIONS; i++) {
+        update_sensors_value(value, i);
+
+        full_bytes += codec->encode_notification("on_sensor_signal", value).length();
+
+        JSONVar changed;
+        if (delta.update("on_sensor_signal", value, &changed)) {
+            sent_bytes += codec->encode_notification("on_sensor_signal", value).length();
+        }
+        else {
+            sent_bytes += codec->encode_delta_notification("on_sensor_signal", changed).length();
+        }
+    }
+    unsigned long elapsed = micros() - start;
+
+    Serial.printf("delta %-14s %5lu bytes/update, %5lu whole (%lu%%), %lu keyframes %8.2f us/op\n",
+                  codec->name(), sent_bytes / ITERATIONS, full_bytes / ITERATIONS,
+                  (sent_bytes * 100) / full_bytes, delta.keyframes, (float) elapsed / ITERATIONS);
+}
+
+void setup() {
+    Serial.begin(9600);
+    delay(1000);
+
+    JSONVarCodec json_var_codec;
+    MinimalCodec minimal_codec;
+    ArduinoJsonCodec *arduino_json_codec = new ArduinoJsonCodec(); // Too big for the stack
+
+    bench_codec(&json_var_codec);
+    bench_codec(&minimal_codec);
+    bench_codec(arduino_json_codec);
+
+    delete arduino_json_codec;
+
+    bench_deflate("NOTIFICATION", minimal_codec.encode_notification("on_sensor_signal", sensors_value()));
+    bench_deflate("CONFIGURATION", String(FPSTR(CONFIGURATION_MESSAGE)));
+    bench_deflate_stream(&minimal_codec);
+
+    bench_delta(&minimal_codec);
+}
+
+void loop() {
+    delay(1000);
+}
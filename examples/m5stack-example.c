@@ -214,112 +214,124 @@ JSONVar clear_screen(JSONVar arguments) {
 WebSocketsClient *webSocket;
 ProgramakerBridge *bridge = NULL;
 
-void tryConfigure() {
-    // Configure when connected
-    signal_argument single_variable_argument = {
+// Blocks, kept on flash
+PROGRAMAKER_STRING(sensor_signal_name, "on_sensor_signal");
+PROGRAMAKER_STRING(sensor_signal_message, "On sensor update. Set %1");
+PROGRAMAKER_STRING(sensor_getter_name, "get_sensors");
+PROGRAMAKER_STRING(sensor_getter_message, "Get sensors");
+PROGRAMAKER_STRING(set_left_bar_name, "set_left_bar");
+PROGRAMAKER_STRING(set_left_bar_message, "Color left bar (r:%1, g:%2, b:%3)");
+PROGRAMAKER_STRING(set_right_bar_name, "set_right_bar");
+PROGRAMAKER_STRING(set_right_bar_message, "Color right bar (r:%1, g:%2, b:%3)");
+PROGRAMAKER_STRING(print_line_name, "print_line");
+PROGRAMAKER_STRING(print_line_message, "Print line: %1");
+PROGRAMAKER_STRING(set_fullscreen_name, "set_fullscreen");
+PROGRAMAKER_STRING(set_fullscreen_message, "Set fullscreen: %1");
+PROGRAMAKER_STRING(clear_screen_name, "clear_screen");
+PROGRAMAKER_STRING(clear_screen_message, "Clear screen");
+PROGRAMAKER_STRING(rgb_default, "255");
+PROGRAMAKER_STRING(string_default, "Hello!");
+
+const signal_argument single_variable_argument[] PROGMEM = {
+    {
         .arg_type=VARIABLE,
         .type=SINGLE,
-    };
-
-    signal_def sensor_signal = {
-        .id="on_sensor_signal",
-        .fun_name="on_sensor_signal",
-        .key="on_sensor_signal",
-        .message="On sensor update. Set %1",
-        .arguments=std::list<signal_argument>({
-                single_variable_argument,
-            }),
+    },
+};
+
+const operation_argument rgb_arguments[] PROGMEM = {
+    { .type=INTEGER, .default_value=rgb_default },
+    { .type=INTEGER, .default_value=rgb_default },
+    { .type=INTEGER, .default_value=rgb_default },
+};
+
+const operation_argument string_argument[] PROGMEM = {
+    { .type=STRING, .default_value=string_default },
+};
+
+const signal_def signals[] PROGMEM = {
+    {
+        .id=sensor_signal_name,
+        .fun_name=sensor_signal_name,
+        .key=sensor_signal_name,
+        .message=sensor_signal_message,
+        .arguments=single_variable_argument,
+        .argument_count=PROGRAMAKER_COUNT(single_variable_argument),
         .save_to={
             .index=0
         }
-    };
+    },
+};
 
-    getter_def sensor_getter = {
-        .id="get_sensors",
-        .fun_name="get_sensors",
-        .message="Get sensors",
-        .arguments=std::list<getter_argument>(),
+const getter_def getters[] PROGMEM = {
+    {
+        .id=sensor_getter_name,
+        .fun_name=sensor_getter_name,
+        .message=sensor_getter_message,
+        .arguments=NULL,
+        .argument_count=0,
         .callback=get_sensors,
-    };
-
-    operation_argument rgb_argument = {
-        .type=INTEGER,
-        .default_value="255",
-    };
-
-    operation_def set_left_bar_op = {
-        .id="set_left_bar",
-        .fun_name="set_left_bar",
-        .message="Color left bar (r:%1, g:%2, b:%3)",
-        .arguments=std::list<operation_argument>({
-                rgb_argument,
-                rgb_argument,
-                rgb_argument,
-            }),
+    },
+};
+
+const operation_def operations[] PROGMEM = {
+    {
+        .id=set_left_bar_name,
+        .fun_name=set_left_bar_name,
+        .message=set_left_bar_message,
+        .arguments=rgb_arguments,
+        .argument_count=PROGRAMAKER_COUNT(rgb_arguments),
         .callback=set_left_bar,
-    };
-
-    operation_def set_right_bar_op = {
-        .id="set_right_bar",
-        .fun_name="set_right_bar",
-        .message="Color right bar (r:%1, g:%2, b:%3)",
-        .arguments=std::list<operation_argument>({
-                rgb_argument,
-                rgb_argument,
-                rgb_argument,
-            }),
+    },
+    {
+        .id=set_right_bar_name,
+        .fun_name=set_right_bar_name,
+        .message=set_right_bar_message,
+        .arguments=rgb_arguments,
+        .argument_count=PROGRAMAKER_COUNT(rgb_arguments),
         .callback=set_right_bar,
-    };
-
-    operation_argument string_argument = {
-        .type=STRING,
-        .default_value="Hello!",
-    };
-
-    operation_def print_line_op = {
-        .id="print_line",
-        .fun_name="print_line",
-        .message="Print line: %1",
-        .arguments=std::list<operation_argument>({
-                string_argument,
-            }),
+    },
+    {
+        .id=print_line_name,
+        .fun_name=print_line_name,
+        .message=print_line_message,
+        .arguments=string_argument,
+        .argument_count=PROGRAMAKER_COUNT(string_argument),
         .callback=print_line,
-    };
-
-    operation_def set_fullscreen_op = {
-        .id="set_fullscreen",
-        .fun_name="set_fullscreen",
-        .message="Set fullscreen: %1",
-        .arguments=std::list<operation_argument>({
-                string_argument,
-            }),
+    },
+    {
+        .id=set_fullscreen_name,
+        .fun_name=set_fullscreen_name,
+        .message=set_fullscreen_message,
+        .arguments=string_argument,
+        .argument_count=PROGRAMAKER_COUNT(string_argument),
         .callback=set_fullscreen,
-    };
-
-    operation_def clear_screen_op = {
-        .id="clear_screen",
-        .fun_name="clear_screen",
-        .message="Clear screen",
-        .arguments=std::list<operation_argument>({}),
+    },
+    {
+        .id=clear_screen_name,
+        .fun_name=clear_screen_name,
+        .message=clear_screen_message,
+        .arguments=NULL,
+        .argument_count=0,
         .callback=clear_screen,
-    };
+    },
+};
+
+const block_registry blocks PROGMEM = {
+    .signals=signals,
+    .signal_count=PROGRAMAKER_COUNT(signals),
+    .getters=getters,
+    .getter_count=PROGRAMAKER_COUNT(getters),
+    .operations=operations,
+    .operation_count=PROGRAMAKER_COUNT(operations),
+};
 
+void tryConfigure() {
+    // Configure when connected
     bridge = new ProgramakerBridge(webSocket,
                                    BRIDGE_TOKEN,
                                    "M5Stack",
-                                   std::list<signal_def>({
-                                           sensor_signal,
-                                       }),
-                                   std::list<getter_def>({
-                                           sensor_getter,
-                                       }),
-                                   std::list<operation_def>({
-                                           set_left_bar_op,
-                                           set_right_bar_op,
-                                           print_line_op,
-                                           set_fullscreen_op,
-                                           clear_screen_op,
-                                       }));
+                                   &blocks);
 }
 
 void webSocketEvent(WStype_t type, uint8_t * payload, size_t length) {
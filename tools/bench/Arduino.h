@@ -0,0 +1,153 @@
+// Host stand-in of the parts of the Arduino core used by the bridge headers,
+// Arduino_JSON and ArduinoJson, to build examples/codec-benchmark.c on the
+// host (see codec_bench.cpp). Flash is ordinary memory here.
+#pragma once
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#define PROGMEM
+#define PGM_P const char*
+
+class __FlashStringHelper;
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper*>(p))
+#define F(s) FPSTR(s)
+
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+#define strlen_P strlen
+#define pgm_read_byte(p) (*(const uint8_t*) (p))
+#define pgm_read_word(p) (*(const uint16_t*) (p))
+
+inline unsigned long micros() {
+    static auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() {
+    return micros() / 1000;
+}
+
+inline void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+class String {
+    std::string s;
+
+public:
+    String(const char* str = "") : s(str != NULL ? str : "") {}
+    String(const __FlashStringHelper* str) : String((const char*) str) {}
+    String(char c) : s(1, c) {}
+    String(int value) : s(std::to_string(value)) {}
+    String(unsigned int value) : s(std::to_string(value)) {}
+    String(long value) : s(std::to_string(value)) {}
+    String(unsigned long value) : s(std::to_string(value)) {}
+    String(double value, unsigned int decimals = 2) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+        s = buffer;
+    }
+
+    const char* c_str() const { return s.c_str(); }
+    unsigned int length() const { return s.length(); }
+    bool reserve(unsigned int size) { s.reserve(size); return true; }
+    char* begin() { return &s[0]; }
+    char* end() { return &s[0] + s.length(); }
+    const char* begin() const { return s.c_str(); }
+    const char* end() const { return s.c_str() + s.length(); }
+
+    bool concat(const String& str) { s += str.s; return true; }
+    bool concat(const char* str) { if (str == NULL) return false; s += str; return true; }
+    bool concat(const char* str, unsigned int length) { s.append(str, length); return true; }
+    bool concat(char c) { s += c; return true; }
+
+    String& operator+=(const String& str) { concat(str); return *this; }
+    String& operator+=(const char* str) { concat(str); return *this; }
+    String& operator+=(char c) { concat(c); return *this; }
+
+    char operator[](unsigned int index) const { return s[index]; }
+    char& operator[](unsigned int index) { return s[index]; }
+
+    bool operator==(const String& other) const { return s == other.s; }
+    bool operator==(const char* other) const { return s == other; }
+    bool operator!=(const String& other) const { return s != other.s; }
+    bool operator!=(const char* other) const { return s != other; }
+
+    int indexOf(const char* str) const {
+        size_t found = s.find(str);
+        return (found == std::string::npos) ? -1 : (int) found;
+    }
+    String substring(unsigned int from) const { return String(s.substr(from).c_str()); }
+    long toInt() const { return atol(s.c_str()); }
+};
+
+class StringSumHelper : public String {
+public:
+    using String::String;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) {
+            n += write(*buffer++);
+        }
+        return n;
+    }
+
+    size_t print(const char* str) { return write((const uint8_t*) str, strlen(str)); }
+    size_t print(const String& str) { return print(str.c_str()); }
+    size_t println() { return print("\n"); }
+    size_t println(const char* str) { return print(str) + println(); }
+    size_t println(const String& str) { return println(str.c_str()); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return write((const uint8_t*) buffer, (length < (int) sizeof(buffer)) ? length : sizeof(buffer) - 1);
+    }
+};
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+class HostSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    void setDebugOutput(bool) {}
+    size_t write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+    size_t write(const uint8_t* buffer, size_t size) { return fwrite(buffer, 1, size, stdout); }
+};
+
+inline HostSerial Serial;
+
+// Heap accounting, kept by the malloc() on codec_bench.cpp
+size_t host_heap_used();
+size_t host_heap_peak();
+void host_heap_peak_reset();
+
+// Large enough to never run out, only differences are meaningful
+#define HOST_HEAP_SIZE (1UL << 30)
+
+class EspClass {
+public:
+    uint32_t getFreeHeap() { return HOST_HEAP_SIZE - host_heap_used(); }
+};
+
+inline EspClass ESP;
@@ -0,0 +1,48 @@
+// Declarations of arduinoWebSockets needed by permessage_deflate.hpp. The
+// benchmark only uses its encoder and decoder, the client is never run.
+#pragma once
+#include <Arduino.h>
+
+typedef enum {
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+} WStype_t;
+
+typedef enum {
+    WSop_continuation = 0x00,
+    WSop_text = 0x01,
+    WSop_binary = 0x02,
+} WSopcode_t;
+
+typedef struct {
+    bool fin;
+    bool rsv1;
+} WSMessageHeader_t;
+
+typedef struct {
+    String cExtensions;
+    WSMessageHeader_t cWsHeaderDecode;
+} WSclient_t;
+
+class WebSocketsClient {
+protected:
+    WSclient_t _client;
+
+    virtual void runCbEvent(WStype_t type, uint8_t* payload, size_t length) {}
+    virtual void messageReceived(WSclient_t* client, WSopcode_t opcode, uint8_t* payload,
+                                 size_t length, bool fin) {}
+
+public:
+    virtual ~WebSocketsClient() {}
+
+    bool isConnected() { return false; }
+    void setExtraHeaders(const char* headers) {}
+    bool sendTXT(String& payload) { return false; }
+    bool sendFrame(WSclient_t* client, WSopcode_t opcode, uint8_t* payload = NULL,
+                   size_t length = 0, bool fin = true, bool headerToPayload = false) {
+        return false;
+    }
+};
@@ -0,0 +1,81 @@
+// Host build of examples/codec-benchmark.c, with the real Arduino_JSON and
+// ArduinoJson libraries and a stand-in of the Arduino core (Arduino.h).
+//
+// Build, size and run it with codec_bench.sh. The peak heap of each
+// operation is counted by the malloc() below (usable size of every block,
+// including the copies of String), and the time is from steady_clock, so
+// only the ratios between codecs carry over to the ESP8266.
+
+#include <malloc.h>
+#include <stdlib.h>
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void __libc_free(void* pointer);
+}
+
+static size_t heap_used = 0;
+static size_t heap_peak = 0;
+
+static void heap_add(void* pointer) {
+    if (pointer != NULL) {
+        heap_used += malloc_usable_size(pointer);
+        if (heap_used > heap_peak) {
+            heap_peak = heap_used;
+        }
+    }
+}
+
+static void heap_remove(void* pointer) {
+    if (pointer != NULL) {
+        heap_used -= malloc_usable_size(pointer);
+    }
+}
+
+extern "C" void* malloc(size_t size) noexcept {
+    void* pointer = __libc_malloc(size);
+    heap_add(pointer);
+    return pointer;
+}
+
+extern "C" void* calloc(size_t count, size_t size) noexcept {
+    void* pointer = __libc_calloc(count, size);
+    heap_add(pointer);
+    return pointer;
+}
+
+extern "C" void* realloc(void* pointer, size_t size) noexcept {
+    size_t previous = (pointer != NULL) ? malloc_usable_size(pointer) : 0;
+    void* reallocated = __libc_realloc(pointer, size);
+    if ((reallocated != NULL) || (size == 0)) {
+        heap_used -= previous;
+        heap_add(reallocated);
+    }
+    return reallocated;
+}
+
+extern "C" void free(void* pointer) noexcept {
+    heap_remove(pointer);
+    __libc_free(pointer);
+}
+
+size_t host_heap_used() {
+    return heap_used;
+}
+
+size_t host_heap_peak() {
+    return heap_peak;
+}
+
+void host_heap_peak_reset() {
+    heap_peak = heap_used;
+}
+
+#include "codec-benchmark.c"
+
+int main() {
+    setup();
+    return 0;
+}
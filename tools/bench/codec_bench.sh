@@ -0,0 +1,64 @@
+#!/bin/sh
+# Build examples/codec-benchmark.c for the host, print the code size of each
+# codec and run it.
+#
+#   git clone https://github.com/arduino-libraries/Arduino_JSON
+#   git clone -b 6.x https://github.com/bblanchon/ArduinoJson
+#   tools/bench/codec_bench.sh Arduino_JSON ArduinoJson
+#
+# Code size is the text of the codec methods on the benchmark object, with
+# the ArduinoJson templates counted for ArduinoJsonCodec and the json_*
+# scanner for MinimalCodec. Arduino_JSON is used by all of them for the
+# block values, so it's printed apart. Sizes are for x86-64 at -Os, use them
+# to compare the codecs, not as the size on the ESP8266.
+
+set -e
+
+if [ $# -ne 2 ]; then
+    echo "Usage: $0 <Arduino_JSON checkout> <ArduinoJson checkout>" >&2
+    exit 2
+fi
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+ARDUINO_JSON=$(cd "$1" && pwd)/src
+ARDUINOJSON=$(cd "$2" && pwd)/src
+OUT=${OUT:-/tmp/codec_bench}
+CXXFLAGS="-Os -I $ROOT/tools/bench -I $ARDUINO_JSON"
+
+mkdir -p "$OUT"
+
+# Arduino_JSON, shared by all the codecs
+gcc -Os -c "$ARDUINO_JSON/cjson/cJSON.c" -o "$OUT/cJSON.o"
+g++ -std=gnu++17 $CXXFLAGS -c "$ARDUINO_JSON/JSON.cpp" -o "$OUT/JSON.o"
+g++ -std=gnu++17 $CXXFLAGS -c "$ARDUINO_JSON/JSONVar.cpp" -o "$OUT/JSONVar.o"
+
+g++ -std=gnu++17 $CXXFLAGS -I "$ARDUINOJSON" -I "$ROOT/arduino_for_programaker" -I "$ROOT/examples" \
+    -DARDUINOJSON_ENABLE_ARDUINO_STRING=1 -DARDUINOJSON_ENABLE_ARDUINO_STREAM=0 \
+    -DARDUINOJSON_ENABLE_ARDUINO_PRINT=0 -DARDUINOJSON_ENABLE_PROGMEM=0 \
+    -c "$ROOT/tools/bench/codec_bench.cpp" -o "$OUT/codec_bench.o"
+g++ "$OUT/codec_bench.o" "$OUT/JSON.o" "$OUT/JSONVar.o" "$OUT/cJSON.o" -o "$OUT/codec_bench"
+
+echo "Code size (x86-64, -Os):"
+nm -C -S --size-sort "$OUT/codec_bench.o" | awk '
+    function hex(digits,    i, value) {
+        value = 0
+        for (i = 1; i <= length(digits); i++) {
+            value = (value * 16) + index("0123456789abcdef", tolower(substr(digits, i, 1))) - 1
+        }
+        return value
+    }
+    $3 ~ /^[tTwW]$/ {
+        name = substr($0, index($0, $4))
+        if (name ~ /JSONVarCodec::/) codec = "Arduino_JSON"
+        else if (name ~ /ArduinoJson/) codec = "ArduinoJson"
+        else if (name ~ /MinimalCodec::/ || name ~ /^json_/) codec = "Minimal"
+        else next
+        size[codec] += hex($2)
+    }
+    END {
+        for (codec in size) printf "  %-14s %6d bytes\n", codec, size[codec]
+    }'
+size -t "$OUT/JSON.o" "$OUT/JSONVar.o" "$OUT/cJSON.o" | awk 'END { printf "  %-14s %6d bytes (shared)\n", "Arduino_JSON lib", $1 }'
+echo
+
+"$OUT/codec_bench"
@@ -0,0 +1,11 @@
+// Host stand-in of the ESP8266 heap statistics, see Arduino.h
+#pragma once
+#include <Arduino.h>
+
+inline size_t umm_free_heap_size_min() {
+    return HOST_HEAP_SIZE - host_heap_peak();
+}
+
+inline void umm_free_heap_size_min_reset() {
+    host_heap_peak_reset();
+}
@@ -0,0 +1,37 @@
+// Minimal stand-in of the Arduino headers used by programaker_codec.hpp, to
+// build the scanner and the classifier on the host. JSONVar is not
+// functional, only the raw-frame code paths are meant to run here.
+#pragma once
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+struct String : std::string {
+    String() {}
+    String(const char* s) : std::string(s) {}
+    void reserve(size_t n) { std::string::reserve(n); }
+    size_t length() const { return size(); }
+    String& operator+=(const char* s) { append(s); return *this; }
+    String& operator+=(char c) { push_back(c); return *this; }
+    String& operator+=(const String& s) { append(s); return *this; }
+};
+
+struct JSONVar {
+    JSONVar() {}
+    JSONVar(const char*) {}
+    JSONVar(bool) {}
+    JSONVar(std::nullptr_t) {}
+    JSONVar operator[](const char*) const { return JSONVar(); }
+    operator const char*() const { return nullptr; }
+    template <typename T> JSONVar& operator=(const T&) { return *this; }
+};
+
+struct JSONClass {
+    JSONVar parse(const char*) { return JSONVar(); }
+    String stringify(const JSONVar&) { return String("null"); }
+    String typeof_(const JSONVar&) { return String("undefined"); }
+};
+static JSONClass JSON;
@@ -0,0 +1,196 @@
+// Host fuzzer and benchmark for the frame classifier (message_classifier.hpp)
+// and the in-place decoder of MinimalCodec (programaker_codec.hpp).
+//
+// Build and run from the repository root:
+//
+//   g++ -std=gnu++17 -O1 -g -fsanitize=address,undefined
+//       -I tools/fuzz -I arduino_for_programaker
+//       tools/fuzz/fuzz_classifier.cpp -o fuzz_classifier
+//   ./fuzz_classifier tools/fuzz/corpus 1000000
+//
+// First the corpus files are checked against the class in their name
+// (`<class>-<description>.json`), then they are mutated for the given number
+// of iterations. Every frame is copied to a buffer of its exact size, so
+// reads past the end are caught by the address sanitizer. Finally the
+// classification time per frame of the corpus is printed.
+//
+// With clang, -DLIBFUZZER -fsanitize=fuzzer builds it as a libFuzzer target
+// instead, using the same corpus.
+
+#include "programaker_codec.hpp"
+#include "message_classifier.hpp"
+
+#include <dirent.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+static const char* CLASS_NAMES[] = {
+    "function_call",
+    "registration",
+    "get_how_to_service_registration",
+    "unknown",
+    "malformed",
+};
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "Check failed: %s\n", what);
+        abort();
+    }
+}
+
+static enum MESSAGE_CLASS run_frame(const uint8_t* data, size_t size) {
+    char* frame = (char*) malloc(size > 0 ? size : 1);
+    memcpy(frame, data, size);
+
+    message_classification classification;
+    classify_message(frame, size, &classification);
+
+    if (classification.message_id != NULL) {
+        check((classification.message_id >= frame)
+              && ((classification.message_id + classification.message_id_length) <= (frame + size)),
+              "message_id inside the frame");
+        check(classification.message_id[0] == '"', "message_id is a string");
+    }
+    if (classification.message_class == MESSAGE_FUNCTION_CALL) {
+        check(classification.message_id != NULL, "calls have a message_id");
+
+        // Classified frames are decoded in place, as the bridge does
+        MinimalCodec codec;
+        programaker_message message;
+        if (codec.decode(frame, size, &message)) {
+            check(message.message_id != NULL, "decoded message_id");
+        }
+    }
+
+    free(frame);
+    return classification.message_class;
+}
+
+#ifdef LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    run_frame(data, size);
+    return 0;
+}
+
+#else
+
+// Tokens spliced in by the mutator
+static const char* TOKENS[] = {
+    "{", "}", "[", "]", ":", ",", "\"", "\\", "\\u00e9", "\\ud83d\\ude00",
+    "true", "false", "null", "tru", "nul", "-0.5e+10", "1.2.3", "01", "1e",
+    "\"type\"", "\"message_id\"", "\"value\"", "\"FUNCTION_CALL\"",
+    "\"function_name\"", "\"arguments\"", "[[[[[[[[[[[[[[[[[[",
+};
+
+static std::string mutate(std::string frame, std::mt19937& random) {
+    int mutations = 1 + (random() % 4);
+    for (int i = 0; i < mutations; i++) {
+        size_t position = frame.empty() ? 0 : (random() % (frame.size() + 1));
+        switch (random() % 5) {
+        case 0: // Flip a bit
+            if (position < frame.size()) {
+                frame[position] ^= 1 << (random() % 8);
+            }
+            break;
+        case 1: // Remove a run of bytes
+            frame.erase(position, random() % 8);
+            break;
+        case 2: // Insert a random byte
+            frame.insert(position, 1, (char) (random() % 256));
+            break;
+        case 3: // Insert a JSON token
+            frame.insert(position, TOKENS[random() % (sizeof(TOKENS) / sizeof(TOKENS[0]))]);
+            break;
+        case 4: // Truncate
+            frame.resize(position);
+            break;
+        }
+    }
+    return frame;
+}
+
+static std::vector<std::pair<std::string, std::string>> load_corpus(const char* path) {
+    std::vector<std::pair<std::string, std::string>> corpus;
+
+    DIR* dir = opendir(path);
+    check(dir != NULL, "corpus directory can be opened");
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+
+        std::string file_path = std::string(path) + "/" + entry->d_name;
+        FILE* file = fopen(file_path.c_str(), "rb");
+        if (file == NULL) {
+            continue;
+        }
+        std::string contents;
+        char buffer[4096];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            contents.append(buffer, read);
+        }
+        fclose(file);
+
+        corpus.push_back(std::make_pair(std::string(entry->d_name), contents));
+    }
+    closedir(dir);
+    return corpus;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <corpus directory> [iterations]\n", argv[0]);
+        return 2;
+    }
+    long iterations = (argc > 2) ? atol(argv[2]) : 100000;
+
+    std::vector<std::pair<std::string, std::string>> corpus = load_corpus(argv[1]);
+    check(!corpus.empty(), "corpus is not empty");
+
+    // Expected classes
+    int failures = 0;
+    for (auto& seed : corpus) {
+        enum MESSAGE_CLASS found = run_frame((const uint8_t*) seed.second.data(), seed.second.size());
+        std::string expected = seed.first.substr(0, seed.first.find('-'));
+        if (expected != CLASS_NAMES[found]) {
+            printf("%s: classified as %s\n", seed.first.c_str(), CLASS_NAMES[found]);
+            failures++;
+        }
+    }
+    printf("%zu corpus frames, %d misclassified\n", corpus.size(), failures);
+
+    // Mutations
+    std::mt19937 random(1);
+    long counts[MESSAGE_MALFORMED + 1] = {0};
+    for (long i = 0; i < iterations; i++) {
+        std::string frame = mutate(corpus[random() % corpus.size()].second, random);
+        counts[run_frame((const uint8_t*) frame.data(), frame.size())]++;
+    }
+    printf("%ld mutated frames:", iterations);
+    for (int i = 0; i <= MESSAGE_MALFORMED; i++) {
+        printf(" %s=%ld", CLASS_NAMES[i], counts[i]);
+    }
+    printf("\n");
+
+    // Classification time, without the copies and checks
+    const int rounds = 10000;
+    message_classification classification;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        for (auto& seed : corpus) {
+            classify_message(seed.second.data(), seed.second.size(), &classification);
+        }
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("%.0f ns per corpus frame\n", elapsed / (rounds * corpus.size()));
+
+    return (failures == 0) ? 0 : 1;
+}
+
+#endif
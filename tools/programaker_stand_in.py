@@ -0,0 +1,449 @@
+#!/usr/bin/env python3
+"""Local stand-in for the PrograMaker bridge endpoint, with a load generator.
+
+Accepts the bridge websocket connection, handles AUTHENTICATION,
+CONFIGURATION and CONFIGURATION_UPDATE and then sends FUNCTION_CALLs at a
+configurable rate, while collecting the NOTIFICATIONs sent by the device. At the end it reports:
+
+  - Call latency percentiles, from the call being sent to its response.
+  - Signals received, and their rate.
+  - Reconnect times, from a disconnection to the next CONFIGURATION.
+  - With --deflate, the compression ratio of the frames sent by the device.
+  - For the signals sent as deltas, the bytes per update against sending
+    the whole value.
+
+To point the device to it use the non-secure configuration on `secrets.h`,
+with ENDPOINT_HOST set to this machine. Any ENDPOINT_PATH is accepted. To
+measure the TLS handshake too, pass --certfile and --keyfile and use the
+secure configuration, with the certificate as ENDPOINT_CA_CERT.
+
+Requires the `websockets` package.
+"""
+
+import argparse
+import asyncio
+import copy
+import json
+import random
+import ssl
+import time
+import uuid
+
+import websockets
+from websockets.extensions.permessage_deflate import (
+    PerMessageDeflate,
+    ServerPerMessageDeflateFactory,
+)
+
+
+def percentile(values, pct):
+    if not values:
+        return None
+    values = sorted(values)
+    index = min(len(values) - 1, int(round((pct / 100) * (len(values) - 1))))
+    return values[index]
+
+
+class DeltaReceiver:
+    """Rebuilds the values of the signals sent as deltas (see signal_delta.hpp)
+    and measures their size against the notifications with the whole value."""
+
+    def __init__(self):
+        self.values = {}
+        self.lost = 0
+        # Per key: keyframes, deltas, bytes received, bytes if sent whole
+        self.counters = {}
+
+    @staticmethod
+    def merge(value, delta):
+        for field, field_value in delta.items():
+            if isinstance(field_value, dict) and isinstance(value.get(field), dict):
+                DeltaReceiver.merge(value[field], field_value)
+            else:
+                value[field] = copy.deepcopy(field_value)
+
+    @staticmethod
+    def full_size(key, value):
+        # As the bridge would send it
+        return len(json.dumps({
+            "type": "NOTIFICATION",
+            "key": key,
+            "to_user": None,
+            "content": value,
+            "value": value,
+        }, separators=(",", ":")))
+
+    def on_notification(self, message, frame_length):
+        """Returns the whole value of the signal, or None if a delta is
+        received without a previous keyframe."""
+        key = message.get("key")
+        value = message.get("value")
+
+        if not message.get("delta"):
+            if not isinstance(value, dict):
+                return value
+            self.values[key] = copy.deepcopy(value)
+            counters = self.counters.setdefault(key, [0, 0, 0, 0])
+            counters[0] += 1
+            counters[2] += frame_length
+            counters[3] += frame_length
+            return value
+
+        if key not in self.values:
+            self.lost += 1
+            return None
+
+        self.merge(self.values[key], value)
+        counters = self.counters[key]
+        counters[1] += 1
+        counters[2] += frame_length
+        counters[3] += self.full_size(key, self.values[key])
+        return self.values[key]
+
+    def report(self):
+        for key, (keyframes, deltas, frame_bytes, full_bytes) in sorted(self.counters.items()):
+            if not deltas:
+                continue
+            updates = keyframes + deltas
+            print("Delta signal {}: {} keyframes, {} deltas, {:.1f} bytes/update,"
+                  " {:.1f} if sent whole ({:.1f}%)".format(
+                      key, keyframes, deltas, frame_bytes / updates, full_bytes / updates,
+                      100 * frame_bytes / full_bytes))
+        if self.lost:
+            print("Deltas without keyframe: {}".format(self.lost))
+
+
+class Stats:
+    def __init__(self):
+        self.latencies = []
+        self.errors = 0
+        self.timeouts = 0
+        self.signals = {}
+        self.first_signal = None
+        self.last_signal = None
+        self.reconnect_times = []
+        self.connections = 0
+        self.configuration_updates = 0
+        self.delta = DeltaReceiver()
+        self.compressed_frames = 0
+        self.compressed_bytes = 0
+        self.inflated_bytes = 0
+
+    def add_signal(self, key):
+        now = time.monotonic()
+        if self.first_signal is None:
+            self.first_signal = now
+        self.last_signal = now
+        self.signals[key] = self.signals.get(key, 0) + 1
+
+    def report(self):
+        print("\n=== Results ===")
+        print("Connections: {}".format(self.connections))
+        if self.configuration_updates:
+            print("Configuration updates: {}".format(self.configuration_updates))
+
+        print("Calls answered: {}, errors: {}, timeouts: {}".format(
+            len(self.latencies), self.errors, self.timeouts))
+        if self.latencies:
+            print("Call latency (ms): p50={:.1f} p90={:.1f} p99={:.1f} max={:.1f}".format(
+                percentile(self.latencies, 50) * 1000,
+                percentile(self.latencies, 90) * 1000,
+                percentile(self.latencies, 99) * 1000,
+                max(self.latencies) * 1000))
+
+        total_signals = sum(self.signals.values())
+        print("Signals received: {}".format(total_signals))
+        if total_signals > 1:
+            elapsed = self.last_signal - self.first_signal
+            print("Signal rate: {:.2f}/s".format(total_signals / elapsed if elapsed > 0 else 0))
+        for key, count in sorted(self.signals.items()):
+            print("  {}: {}".format(key, count))
+
+        self.delta.report()
+
+        if self.compressed_frames:
+            print("Compressed frames: {}, {} -> {} bytes ({:.1f}%)".format(
+                self.compressed_frames, self.inflated_bytes, self.compressed_bytes,
+                100 * self.compressed_bytes / self.inflated_bytes))
+
+        if self.reconnect_times:
+            print("Reconnect time (ms): p50={:.1f} max={:.1f} ({} reconnections)".format(
+                percentile(self.reconnect_times, 50) * 1000,
+                max(self.reconnect_times) * 1000,
+                len(self.reconnect_times)))
+
+
+class DeflateStats(PerMessageDeflate):
+    """permessage-deflate in both directions, measuring the frames received
+    compressed from the bridge."""
+
+    stats = None
+
+    def decode(self, frame, *, max_size=None):
+        compressed = frame.rsv1
+        compressed_length = len(frame.data)
+        frame = super().decode(frame, max_size=max_size)
+        if compressed:
+            self.stats.compressed_frames += 1
+            self.stats.compressed_bytes += compressed_length
+            self.stats.inflated_bytes += len(frame.data)
+        return frame
+
+
+class DeflateStatsFactory(ServerPerMessageDeflateFactory):
+    def __init__(self, stats):
+        super().__init__()
+        self.stats = stats
+
+    def process_request_params(self, params, accepted_extensions):
+        response_params, extension = super().process_request_params(
+            params, accepted_extensions)
+        extension.__class__ = DeflateStats
+        extension.stats = self.stats
+        return response_params, extension
+
+
+class CallMix:
+    """Calls to send, picked randomly by weight or replayed in order."""
+
+    def __init__(self, calls, replay):
+        self.calls = calls
+        self.replay = replay
+        self.replay_index = 0
+        self.explicit = bool(calls or replay)
+        self.blocks = {}
+
+    @staticmethod
+    def from_args(args):
+        calls = []
+        for spec in args.call:
+            # function_name[:weight[:arguments_json]]
+            parts = spec.split(":", 2)
+            weight = float(parts[1]) if len(parts) > 1 else 1.0
+            arguments = json.loads(parts[2]) if len(parts) > 2 else []
+            calls.append((parts[0], weight, arguments))
+
+        replay = []
+        if args.replay:
+            with open(args.replay) as f:
+                for line in f:
+                    line = line.strip()
+                    if not line:
+                        continue
+                    message = json.loads(line)
+                    if message.get("type") == "FUNCTION_CALL":
+                        value = message["value"]
+                        replay.append((value["function_name"], value.get("arguments", [])))
+
+        return CallMix(calls, replay)
+
+    def set_blocks(self, blocks):
+        """Without explicit calls, call the configured operations and getters."""
+        self.blocks = {block.get("id", block["function_name"]): block for block in blocks}
+        self.update_calls()
+
+    def update_blocks(self, blocks, removed):
+        """Apply a CONFIGURATION_UPDATE."""
+        for block in blocks:
+            self.blocks[block.get("id", block["function_name"])] = block
+        for block_id in removed:
+            self.blocks.pop(block_id, None)
+        self.update_calls()
+
+    def update_calls(self):
+        if self.explicit:
+            return
+
+        self.calls = []
+        for block in self.blocks.values():
+            if block.get("block_type") in ("operation", "getter"):
+                arguments = [arg.get("default") for arg in block.get("arguments", [])]
+                self.calls.append((block["function_name"], 1.0, arguments))
+
+    def next(self):
+        if self.replay:
+            call = self.replay[self.replay_index % len(self.replay)]
+            self.replay_index += 1
+            return call
+
+        if not self.calls:
+            return None
+
+        name, _, arguments = random.choices(
+            self.calls, weights=[weight for _, weight, _ in self.calls])[0]
+        return name, arguments
+
+
+class StandIn:
+    def __init__(self, args):
+        self.args = args
+        self.stats = Stats()
+        self.mix = CallMix.from_args(args)
+        self.pending = {}
+        self.disconnected_at = None
+
+    async def send(self, ws, message):
+        data = json.dumps(message)
+        size = self.args.fragment
+        if size and len(data) > size:
+            # Sent as a fragmented message
+            await ws.send([data[i:i + size] for i in range(0, len(data), size)])
+        else:
+            await ws.send(data)
+
+    async def call_loop(self, ws):
+        interval = 1.0 / self.args.rate
+        while True:
+            await asyncio.sleep(interval)
+
+            call = self.mix.next()
+            if call is None:
+                continue
+
+            function_name, arguments = call
+            message_id = str(uuid.uuid4())
+            self.pending[message_id] = time.monotonic()
+
+            await self.send(ws, {
+                "type": "FUNCTION_CALL",
+                "message_id": message_id,
+                "value": {
+                    "function_name": function_name,
+                    "arguments": arguments,
+                },
+                "user_id": None,
+                "extra_data": {},
+            })
+
+            # Expire unanswered calls
+            now = time.monotonic()
+            for expired_id, sent_at in list(self.pending.items()):
+                if now - sent_at > self.args.call_timeout:
+                    del self.pending[expired_id]
+                    self.stats.timeouts += 1
+
+    def on_message(self, data):
+        try:
+            message = json.loads(data)
+        except ValueError:
+            print("Invalid JSON received: {!r}".format(data[:80]))
+            return None
+
+        message_type = message.get("type")
+        if message_type == "AUTHENTICATION":
+            print("AUTHENTICATION received")
+        elif message_type == "CONFIGURATION":
+            blocks = message.get("value", {}).get("blocks", [])
+            print("CONFIGURATION received, {} blocks".format(len(blocks)))
+            self.mix.set_blocks(blocks)
+        elif message_type == "CONFIGURATION_UPDATE":
+            value = message.get("value", {})
+            blocks = value.get("blocks", [])
+            removed = value.get("removed", [])
+            print("CONFIGURATION_UPDATE received, {} blocks updated, {} removed ({} bytes)".format(
+                len(blocks), len(removed), len(data)))
+            self.stats.configuration_updates += 1
+            self.mix.update_blocks(blocks, removed)
+        elif message_type == "NOTIFICATION":
+            self.stats.add_signal(message.get("key"))
+            self.stats.delta.on_notification(message, len(data))
+        elif "message_id" in message:
+            sent_at = self.pending.pop(message["message_id"], None)
+            if sent_at is None:
+                return message_type
+            if message.get("success"):
+                self.stats.latencies.append(time.monotonic() - sent_at)
+            else:
+                self.stats.errors += 1
+                print("Call failed: {}".format(message.get("error")))
+        return message_type
+
+    async def handler(self, ws, path=None):
+        self.stats.connections += 1
+        print("Bridge connected")
+        call_task = None
+
+        async def disconnect_later():
+            await asyncio.sleep(self.args.disconnect_every)
+            print("Injecting disconnection")
+            await ws.close()
+
+        disconnect_task = None
+        if self.args.disconnect_every:
+            disconnect_task = asyncio.ensure_future(disconnect_later())
+
+        try:
+            async for data in ws:
+                message_type = self.on_message(data)
+                if message_type == "CONFIGURATION":
+                    if self.disconnected_at is not None:
+                        self.stats.reconnect_times.append(time.monotonic() - self.disconnected_at)
+                        self.disconnected_at = None
+                    if call_task is None:
+                        call_task = asyncio.ensure_future(self.call_loop(ws))
+        except websockets.ConnectionClosed:
+            pass
+        finally:
+            print("Bridge disconnected")
+            self.disconnected_at = time.monotonic()
+            self.pending.clear()
+            for task in (call_task, disconnect_task):
+                if task is not None:
+                    task.cancel()
+
+    async def run(self):
+        extensions = []
+        if self.args.deflate:
+            extensions.append(DeflateStatsFactory(self.stats))
+
+        ssl_context = None
+        if self.args.certfile:
+            ssl_context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+            ssl_context.load_cert_chain(self.args.certfile, self.args.keyfile)
+
+        async with websockets.serve(self.handler, self.args.host, self.args.port,
+                                    compression=None, extensions=extensions,
+                                    ssl=ssl_context):
+            print("Listening on {}://{}:{}".format(
+                "wss" if ssl_context else "ws", self.args.host, self.args.port))
+            await asyncio.sleep(self.args.duration)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--host", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8888)
+    parser.add_argument("--duration", type=float, default=60,
+                        help="Seconds to run before reporting")
+    parser.add_argument("--rate", type=float, default=5,
+                        help="FUNCTION_CALLs per second")
+    parser.add_argument("--call", action="append", default=[],
+                        help="function_name[:weight[:arguments_json]], can be repeated."
+                        " By default the configured operations and getters are called.")
+    parser.add_argument("--replay",
+                        help="File with recorded messages, one JSON per line."
+                        " Its FUNCTION_CALLs are sent in order.")
+    parser.add_argument("--fragment", type=int, default=0,
+                        help="Split sent messages in fragments of this many bytes")
+    parser.add_argument("--disconnect-every", type=float, default=0,
+                        help="Close the connection this many seconds after it is opened")
+    parser.add_argument("--deflate", action="store_true",
+                        help="Accept permessage-deflate, compressing the frames in both directions")
+    parser.add_argument("--call-timeout", type=float, default=10,
+                        help="Seconds to wait for a call response")
+    parser.add_argument("--certfile",
+                        help="PEM certificate, to accept TLS connections (wss)")
+    parser.add_argument("--keyfile",
+                        help="PEM private key of --certfile, if not included on it")
+    args = parser.parse_args()
+
+    stand_in = StandIn(args)
+    try:
+        asyncio.run(stand_in.run())
+    except KeyboardInterrupt:
+        pass
+    stand_in.stats.report()
+
+
+if __name__ == "__main__":
+    main()